@@ -29,6 +29,10 @@
 #include "Aligner.h"
 #include "Helpers.h"
 #include "Globals.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
 
 // Base class destructor (removes alignment file).
 Aligner::~Aligner()
@@ -37,32 +41,72 @@ Aligner::~Aligner()
         Helpers::RemoveFile(OutputFileName);
 }
 
+// Indexes are named by a hash of the reference contents and of the command that builds
+// them, so one is reused for every alignment to the same contigs, also by other runs.
+// A marker file is written once an index is complete; building and checking for it are
+// serialized by a lock file, so concurrent runs never use an index being built.
+bool Aligner::cachedIndex(const string &cachePath, const string &aligner, const string &indexCommand, string &prefix)
+{
+	char str[MaxLine];
+	uint64_t hash = Helpers::Hash(indexCommand.c_str(), indexCommand.length());
+	if (!Helpers::HashFile(ReferenceFileName, hash))
+		return false;
+	sprintf(str, "%s-%016llx", aligner.c_str(), (unsigned long long)hash);
+	prefix = cachePath + (cachePath[cachePath.length() - 1] == '/' ? "" : "/") + str;
+
+	int lock = open((prefix + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+	if (lock < 0)
+		return false;
+	bool success = flock(lock, LOCK_EX) == 0;
+	if (success && !Helpers::FileExists(prefix + ".done"))
+	{
+		sprintf(str, indexCommand.c_str(), prefix.c_str(), ReferenceFileName.c_str());
+		FILE *done = NULL;
+		success = Helpers::Execute(str) && (done = fopen((prefix + ".done").c_str(), "w")) != NULL;
+		if (done != NULL)
+			fclose(done);
+	}
+	flock(lock, LOCK_UN);
+	close(lock);
+	return success;
+}
+
+// A constant table, as aligners of concurrent libraries are built and cleaned up on several threads.
+const char *BWAAligner::IndexFileExtensions[] = { ".amb", ".ann", ".bwt", ".pac", ".rbwt", ".rpac", ".rsa", ".sa" };
+
 // BWA Aligner ctor
 BWAAligner::BWAAligner(const string &referenceFile, const string &queryFile, const BWAConfiguration &config)
-	: Aligner(referenceFile, queryFile), Configuration(config)
+	: Aligner(referenceFile, queryFile), Configuration(config), streamCached(false)
+{
+}
+
+BWAAligner::~BWAAligner()
+{
+	if (stream != NULL)
+		CloseStream();
+}
+
+// Indexes the reference (or finds it in the index cache). Returns true if successful.
+bool BWAAligner::index(string &prefix, bool &cached)
 {
-	IndexFileExtensions.push_back(".amb");
-	IndexFileExtensions.push_back(".ann");
-	IndexFileExtensions.push_back(".bwt");
-	IndexFileExtensions.push_back(".pac");
-	IndexFileExtensions.push_back(".rbwt");
-	IndexFileExtensions.push_back(".rpac");
-	IndexFileExtensions.push_back(".rsa");
-	IndexFileExtensions.push_back(".sa");
+	char str[MaxLine];
+	cached = Configuration.IndexCachePath.length() > 0;
+	if (cached)
+		return cachedIndex(Configuration.IndexCachePath, "bwa", Configuration.IndexCommand, prefix);
+	prefix = Helpers::TempFile(Configuration.TmpPath);
+	sprintf(str, Configuration.IndexCommand.c_str(), prefix.c_str(), ReferenceFileName.c_str());
+	return Helpers::Execute(str);
 }
 
 // Alignes query to reference using single end BWA alignement. Returns true if successful.
 bool BWAAligner::Align(const string &outFile)
 {
 	char str[MaxLine];
-	bool success = true;
 	OutputFileName.clear();
 
 	string prefix, outSai;
-	prefix = Helpers::TempFile(Configuration.TmpPath);
-	sprintf(str, Configuration.IndexCommand.c_str(), prefix.c_str(), ReferenceFileName.c_str());
-	if (!Helpers::Execute(str))
-		success = false;
+	bool cached;
+	bool success = index(prefix, cached);
 	if (success)
 	{
 		outSai = Helpers::TempFile(Configuration.TmpPath);
@@ -81,7 +125,8 @@ bool BWAAligner::Align(const string &outFile)
 			success = false;
 	}
 
-	removeIndexFiles(prefix);
+	if (!cached)
+		removeIndexFiles(prefix);
 	if (outSai.length() > 0)
 		Helpers::RemoveFile(outSai);
 	if (!success && OutputFileName.length() > 0)
@@ -96,25 +141,84 @@ bool BWAAligner::Align(const string &outFile)
 // Removes index files of BWA aligner with given prefix
 void BWAAligner::removeIndexFiles(const string &prefix)
 {
-	int nSuffix = IndexFileExtensions.size();
+	int nSuffix = sizeof(IndexFileExtensions) / sizeof(IndexFileExtensions[0]);
 	for (int i = 0; i < nSuffix; i++)
 		Helpers::RemoveFile(prefix + IndexFileExtensions[i]);
 }
 
-vector<string> BWAAligner::IndexFileExtensions;
+// Indexes the reference and starts the suffix array search and samse as one shell command,
+// whose standard output is the returned pipe. The search writes its .sai file as usual, since
+// samse cannot read it from a pipe.
+FILE *BWAAligner::OpenStream()
+{
+	char str[MaxLine];
+	if (stream != NULL)
+		return NULL;
+
+	if (index(streamPrefix, streamCached))
+	{
+		streamSai = Helpers::TempFile(Configuration.TmpPath);
+		if (Configuration.ExactMatch)
+			sprintf(str, Configuration.SuffixArrayExactCommand.c_str(), Configuration.NumberOfThreads, streamSai.c_str(), streamPrefix.c_str(), QueryFileName.c_str());
+		else
+			sprintf(str, Configuration.SuffixArrayCommand.c_str(), Configuration.NumberOfThreads, streamSai.c_str(), streamPrefix.c_str(), QueryFileName.c_str());
+		string command = str;
+		sprintf(str, Configuration.AlignSingleEndStreamCommand.c_str(), Configuration.MaximumHits + 1, streamPrefix.c_str(), streamSai.c_str(), QueryFileName.c_str());
+		command = command + " && " + str;
+		stream = popen(command.c_str(), "r");
+	}
+	if (stream == NULL)
+	{
+		if (!streamCached)
+			removeIndexFiles(streamPrefix);
+		if (streamSai.length() > 0)
+			Helpers::RemoveFile(streamSai);
+		streamSai.clear();
+	}
+	return stream;
+}
+
+// Waits for the streaming alignment to finish and removes its files. Returns true if successful.
+bool BWAAligner::CloseStream()
+{
+	if (stream == NULL)
+		return false;
+	bool success = pclose(stream) == 0;
+	stream = NULL;
+	if (!streamCached)
+		removeIndexFiles(streamPrefix);
+	Helpers::RemoveFile(streamSai);
+	streamSai.clear();
+	return success;
+}
+
+NovoAlignAligner::~NovoAlignAligner()
+{
+	if (stream != NULL)
+		CloseStream();
+}
+
+// Indexes the reference (or finds it in the index cache). Returns true if successful.
+bool NovoAlignAligner::index(string &prefix, bool &cached)
+{
+	char str[MaxLine];
+	cached = Configuration.IndexCachePath.length() > 0;
+	if (cached)
+		return cachedIndex(Configuration.IndexCachePath, "novoalign", Configuration.IndexCommand, prefix);
+	prefix = Helpers::TempFile(Configuration.TmpPath);
+	sprintf(str, Configuration.IndexCommand.c_str(), prefix.c_str(), ReferenceFileName.c_str());
+	return Helpers::Execute(str);
+}
 
 // Alignes query to reference using single end NovoAlign alignement. Returns true if successful.
 bool NovoAlignAligner::Align(const string &outFile)
 {
 	char str[MaxLine];
-	bool success = true;
 	OutputFileName.clear();
 
 	string prefix;
-	prefix = Helpers::TempFile(Configuration.TmpPath);
-	sprintf(str, Configuration.IndexCommand.c_str(), prefix.c_str(), ReferenceFileName.c_str());
-	if (!Helpers::Execute(str))
-		success = false;
+	bool cached;
+	bool success = index(prefix, cached);
 	if (success)
 	{
 		OutputFileName = (outFile.length() > 0 ? outFile : Helpers::TempFile(Configuration.TmpPath));
@@ -123,7 +227,8 @@ bool NovoAlignAligner::Align(const string &outFile)
                     success = false;
 	}
 
-	Helpers::RemoveFile(prefix);
+	if (!cached)
+		Helpers::RemoveFile(prefix);
 	if (!success)
 	{
 		Helpers::RemoveFile(OutputFileName);
@@ -133,6 +238,35 @@ bool NovoAlignAligner::Align(const string &outFile)
 	return success;
 }
 
+// Indexes the reference and starts NovoAlign with its SAM output going to the returned pipe.
+FILE *NovoAlignAligner::OpenStream()
+{
+	char str[MaxLine];
+	if (stream != NULL)
+		return NULL;
+
+	if (index(streamPrefix, streamCached))
+	{
+		sprintf(str, Configuration.AlignSingleEndStreamCommand.c_str(), streamPrefix.c_str(), QueryFileName.c_str());
+		stream = popen(str, "r");
+	}
+	if (stream == NULL && !streamCached)
+		Helpers::RemoveFile(streamPrefix);
+	return stream;
+}
+
+// Waits for the streaming alignment to finish and removes the index. Returns true if successful.
+bool NovoAlignAligner::CloseStream()
+{
+	if (stream == NULL)
+		return false;
+	bool success = pclose(stream) == 0;
+	stream = NULL;
+	if (!streamCached)
+		Helpers::RemoveFile(streamPrefix);
+	return success;
+}
+
 // Aligns query to reference using MUMMER package. Returns true if successful.
 bool MummerAligner::Align(const string &outFile)
 {
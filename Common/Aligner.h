@@ -28,6 +28,7 @@
 #ifndef _ALIGNER_H
 #define _ALIGNER_H
 #include "AlignerConfiguration.h"
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -37,48 +38,79 @@ class Aligner
 {
 public:
 	Aligner(const string &referenceFile, const string &queryFile)
-		: ReferenceFileName(referenceFile), QueryFileName(queryFile), RemoveOutput(true) {};
+		: ReferenceFileName(referenceFile), QueryFileName(queryFile), RemoveOutput(true), stream(NULL) {};
 	virtual ~Aligner();
 
 public:
 	virtual bool Align(const string &outFile = (char *)"") = 0;
+	// Starts the aligner with its SAM output going to a pipe instead of a file, to be read
+	// by AlignmentReader as it is made. Returns NULL if the aligner cannot stream.
+	virtual FILE *OpenStream() { return NULL; };
+	// Closes the pipe, waits for the aligner and removes its files. Returns whether the
+	// aligner succeeded.
+	virtual bool CloseStream() { return false; };
+
+protected:
+	// Finds or builds the index of the reference in cachePath and returns its prefix.
+	bool cachedIndex(const string &cachePath, const string &aligner, const string &indexCommand, string &prefix);
 
 public:
 	const string ReferenceFileName;
 	const string QueryFileName;
 	string OutputFileName;
 	bool RemoveOutput;
+
+protected:
+	FILE *stream;
 };
 
 class BWAAligner : public Aligner
 {
 public:
 	BWAAligner(const string &referenceFile, const string &queryFile, const BWAConfiguration &config);
+	~BWAAligner();
 
 public:
 	bool Align(const string &outFile = (char *)"");
+	FILE *OpenStream();
+	bool CloseStream();
 
 public:
 	BWAConfiguration Configuration;
 
 private:
+	bool index(string &prefix, bool &cached);
 	void removeIndexFiles(const string &prefix);
 
 private:
-	static vector<string> IndexFileExtensions;
+	string streamPrefix, streamSai;
+	bool streamCached;
+
+private:
+	static const char *IndexFileExtensions[];
 };
 
 class NovoAlignAligner : public Aligner
 {
 public:
 	NovoAlignAligner(const string &referenceFile, const string &queryFile, const NovoAlignConfiguration &config)
-		: Aligner(referenceFile, queryFile), Configuration(config) {};
+		: Aligner(referenceFile, queryFile), Configuration(config), streamCached(false) {};
+	~NovoAlignAligner();
 
 public:
 	bool Align(const string &outFile = (char *)"");
+	FILE *OpenStream();
+	bool CloseStream();
 
 public:
 	NovoAlignConfiguration Configuration;
+
+private:
+	bool index(string &prefix, bool &cached);
+
+private:
+	string streamPrefix;
+	bool streamCached;
 };
 
 class MummerAligner : public Aligner
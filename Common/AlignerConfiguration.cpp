@@ -32,6 +32,7 @@
 BWAConfiguration::BWAConfiguration()
 {
 	TmpPath = "/tmp";
+	IndexCachePath = "";
 	NumberOfThreads = 8;
 	MaximumHits = 1000;
 	ExactMatch = false;
@@ -39,14 +40,17 @@ BWAConfiguration::BWAConfiguration()
 	SuffixArrayCommand = "bwa aln -t %i -f %s %s %s >& /dev/null";
 	SuffixArrayExactCommand = "bwa aln -t %i -f %s %s %s >& /dev/null";
 	AlignSingleEndCommand = "bwa samse -f %s -n %i %s %s %s >& /dev/null";
+	AlignSingleEndStreamCommand = "bwa samse -n %i %s %s %s 2> /dev/null";
 }
 
 // Construtor with default configuration parameter settings.
 NovoAlignConfiguration::NovoAlignConfiguration()
 {
 	TmpPath = "/tmp";
+	IndexCachePath = "";
 	IndexCommand = "novoindex -m %s %s >& /dev/null";
 	AlignSingleEndCommand = "(novoalign -d %s -f %s -o SAM -r All > %s) >& /dev/null";
+	AlignSingleEndStreamCommand = "novoalign -d %s -f %s -o SAM -r All 2> /dev/null";
 }
 
 // Construtor with default configuration parameter settings.
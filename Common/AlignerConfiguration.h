@@ -46,7 +46,11 @@ public:
 	string SuffixArrayCommand;
 	string SuffixArrayExactCommand;
 	string AlignSingleEndCommand;
+	// As AlignSingleEndCommand, but writing SAM to standard output.
+	string AlignSingleEndStreamCommand;
 	string TmpPath;
+	// Directory of indexes kept between runs; none are kept if empty.
+	string IndexCachePath;
 };
 
 class NovoAlignConfiguration
@@ -57,7 +61,11 @@ public:
 public:
 	string IndexCommand;
 	string AlignSingleEndCommand;
+	// As AlignSingleEndCommand, but writing SAM to standard output.
+	string AlignSingleEndStreamCommand;
 	string TmpPath;
+	// Directory of indexes kept between runs; none are kept if empty.
+	string IndexCachePath;
 };
 
 class SAMToolsConfiguration
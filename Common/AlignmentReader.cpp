@@ -29,40 +29,94 @@
 #include "AlignmentReader.h"
 #include <string>
 #include <cstdlib>
+#include <cstring>
+#include <stdint.h>
 
 using namespace std;
 
 AlignmentReader::AlignmentReader()
+	: groupSize(0), hasNext(false), sam(NULL)
 {
 	buffer.Name.clear();
 }
 
 bool AlignmentReader::Open(const string &fileName)
 {
-	return reader.Open(fileName);
+	hasNext = false;
+	return bam.Open(fileName);
+}
+
+// Reads SAM text from an already opened stream (e.g. an aligner's standard output). The
+// header is read here, so that the references are known before the first alignment.
+bool AlignmentReader::Open(FILE *sam)
+{
+	if (IsOpen() || sam == NULL)
+		return false;
+	this->sam = sam;
+	samReferences.clear();
+	samReferenceIDs.clear();
+	samLine.clear();
+	while (readLine(samLine) && !samLine.empty() && samLine[0] == '@')
+	{
+		if (samLine.compare(0, 4, "@SQ\t"))
+			continue;
+		RefData reference;
+		reference.RefLength = 0;
+		size_t start = 4;
+		while (start < samLine.length())
+		{
+			size_t end = samLine.find('\t', start);
+			if (end == string::npos)
+				end = samLine.length();
+			if (!samLine.compare(start, 3, "SN:"))
+				reference.RefName = samLine.substr(start + 3, end - start - 3);
+			else if (!samLine.compare(start, 3, "LN:"))
+				reference.RefLength = atoi(samLine.c_str() + start + 3);
+			start = end + 1;
+		}
+		samReferenceIDs[reference.RefName] = samReferences.size();
+		samReferences.push_back(reference);
+	}
+	return true;
 }
 
 bool AlignmentReader::Close()
 {
-	reader.Close();
+	if (sam != NULL)
+	{
+		sam = NULL;
+		samLine.clear();
+		return true;
+	}
+	bam.Close();
+	hasNext = false;
 	return true;
 }
 
 bool AlignmentReader::IsOpen() const
 {
-	return reader.IsOpen();
+	return sam != NULL || bam.IsOpen();
 }
 
 bool AlignmentReader::GetNextAlignmentGroup(vector<BamAlignment> &alg)
 {
 	alg.clear();
+	if (sam == NULL)
+	{
+		if (!readRecordGroup())
+			return false;
+		alg.resize(groupSize);
+		for (int i = 0; i < groupSize; i++)
+			records[i].GetAlignment(alg[i]);
+		return true;
+	}
 	if (!buffer.Name.empty())
 	{
 		alg.push_back(buffer);
 		buffer.Name.clear();
 	}
 	bool read;
-	while ((read = reader.GetNextAlignment(buffer)))
+	while ((read = getNextAlignment(buffer)))
 	{
 		if (!alg.empty() && (alg.end() - 1)->Name != buffer.Name)
 			break;
@@ -72,9 +126,28 @@ bool AlignmentReader::GetNextAlignmentGroup(vector<BamAlignment> &alg)
 	return !alg.empty();
 }
 
+// For BAM files only the first alignment of the group is decoded in full; of the others
+// just the position and the XA tag are read.
 bool AlignmentReader::GetNextAlignmentGroup(BamAlignment &alignment, vector<XATag> &tags)
 {
 	tags.clear();
+	if (sam == NULL)
+	{
+		if (!readRecordGroup())
+			return false;
+		records[0].GetAlignment(alignment);
+		string xaStr;
+		for (int i = 0; i < groupSize; i++)
+		{
+			const BamRecord &record = records[i];
+			if (!record.IsMapped())
+				continue;
+			tags.push_back(XATag(record.Position(), record.RefID(), record.IsReverseStrand()));
+			if (record.GetTag("XA", xaStr))
+				parseXATag(xaStr, tags);
+		}
+		return true;
+	}
 	vector<BamAlignment> alg;
 	if (!GetNextAlignmentGroup(alg))
 		return false;
@@ -93,12 +166,105 @@ bool AlignmentReader::GetNextAlignmentGroup(BamAlignment &alignment, vector<XATa
 
 const RefVector &AlignmentReader::GetReferences() const
 {
-    return reader.GetReferenceData();
+    if (sam != NULL)
+        return samReferences;
+    return bam.GetReferences();
 }
 
 int AlignmentReader::GetReferenceCount() const
 {
-    return reader.GetReferenceCount();
+    if (sam != NULL)
+        return samReferences.size();
+    return bam.GetReferenceCount();
+}
+
+int AlignmentReader::getReferenceID(const string &name) const
+{
+	if (sam == NULL)
+		return bam.GetReferenceID(name);
+	map<string, int>::const_iterator it = samReferenceIDs.find(name);
+	return it == samReferenceIDs.end() ? -1 : it->second;
+}
+
+// Reads the records with the name of the next record into records. Returns false at the end of the file.
+bool AlignmentReader::readRecordGroup()
+{
+	groupSize = 0;
+	if (!hasNext && !bam.GetNextRecord(next))
+		return false;
+	do
+	{
+		if (groupSize == (int)records.size())
+			records.push_back(BamRecord());
+		records[groupSize++].Swap(next);
+	}
+	while ((hasNext = bam.GetNextRecord(next)) && !strcmp(next.Name(), records[0].Name()));
+	return true;
+}
+
+// Reads the next alignment of SAM text.
+bool AlignmentReader::getNextAlignment(BamAlignment &alignment)
+{
+	if (samLine.empty() && !readLine(samLine))
+		return false;
+	bool parsed = parseSAMRecord(samLine, alignment);
+	samLine.clear();
+	return parsed;
+}
+
+// Reads a whole line of SAM text without the line break. Returns false at the end of the stream.
+bool AlignmentReader::readLine(string &line)
+{
+	char chunk[4096];
+	line.clear();
+	while (fgets(chunk, sizeof(chunk), sam) != NULL)
+	{
+		size_t n = strlen(chunk);
+		if (n > 0 && chunk[n - 1] == '\n')
+		{
+			line.append(chunk, n - 1);
+			return true;
+		}
+		line.append(chunk, n);
+	}
+	return !line.empty();
+}
+
+// Fills the fields of an alignment used by the linker (and the integer and string tags) from a
+// SAM record. Returns false if the record has too few fields.
+bool AlignmentReader::parseSAMRecord(const string &line, BamAlignment &alignment) const
+{
+	vector<string> fields;
+	size_t start = 0, end;
+	while ((end = line.find('\t', start)) != string::npos)
+	{
+		fields.push_back(line.substr(start, end - start));
+		start = end + 1;
+	}
+	fields.push_back(line.substr(start));
+	if (fields.size() < 11)
+		return false;
+
+	alignment = BamAlignment();
+	alignment.Name = fields[0];
+	alignment.AlignmentFlag = atoi(fields[1].c_str());
+	alignment.RefID = (fields[2] == "*" ? -1 : getReferenceID(fields[2]));
+	alignment.Position = atoi(fields[3].c_str()) - 1;
+	alignment.MapQuality = atoi(fields[4].c_str());
+	alignment.QueryBases = (fields[9] == "*" ? "" : fields[9]);
+	alignment.Qualities = (fields[10] == "*" ? "" : fields[10]);
+	alignment.Length = alignment.QueryBases.length();
+	for (size_t i = 11; i < fields.size(); i++)
+	{
+		const string &tag = fields[i];
+		if (tag.length() < 5 || tag[2] != ':' || tag[4] != ':')
+			continue;
+		if (tag[3] == 'i')
+			alignment.AddTag(tag.substr(0, 2), "i", (int32_t)atoi(tag.c_str() + 5));
+		else if (tag[3] == 'Z')
+			alignment.AddTag(tag.substr(0, 2), "Z", tag.substr(5));
+	}
+	return true;
 }
 
 void AlignmentReader::parseXATag(const string &str, vector<XATag> &tags)
@@ -121,5 +287,5 @@ XATag AlignmentReader::parseXAEntry(const string &str)
 	int s = ++i;
 	while (i < n - 1 && str[i] != ',') i++;
 	string position = str.substr(s, i - s);
-	return XATag(atoi(position.c_str() + 1), reader.GetReferenceID(name), position[0] == '-');
+	return XATag(atoi(position.c_str() + 1), getReferenceID(name), position[0] == '-');
 }
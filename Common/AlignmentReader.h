@@ -30,7 +30,10 @@
 #define _ALIGNMENTREADER_H
 
 #include <iostream>
-#include "api/BamReader.h"
+#include <cstdio>
+#include <map>
+#include "api/BamAlignment.h"
+#include "BamInput.h"
 #include "XATag.h"
 
 using namespace std;
@@ -43,6 +46,7 @@ public:
 
 public:
 	bool Open(const string &fileName);
+	bool Open(FILE *sam);
 	bool Close();
 	bool IsOpen() const;
 	bool GetNextAlignmentGroup(vector<BamAlignment> &alg);
@@ -55,9 +59,28 @@ public:
 private:
 	void parseXATag(const string &str, vector<XATag> &tags);
 	XATag parseXAEntry(const string &str);
+	int getReferenceID(const string &name) const;
+	bool getNextAlignment(BamAlignment &alignment);
+	bool readLine(string &line);
+	bool parseSAMRecord(const string &line, BamAlignment &alignment) const;
+	bool readRecordGroup();
 
 private:
-	BamReader reader;
+	// BAM records of the current group (the first groupSize of records, whose memory is
+	// reused) and the first record of the next one, once read
+	BamInput bam;
+	vector<BamRecord> records;
+	int groupSize;
+	BamRecord next;
+	bool hasNext;
+
+	// alignment read ahead from SAM text
 	BamAlignment buffer;
+
+	// SAM text read from a pipe or file (owned by the caller) instead of a BAM file
+	FILE *sam;
+	string samLine;
+	RefVector samReferences;
+	map<string, int> samReferenceIDs;
 };
 #endif
@@ -0,0 +1,371 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "BamInput.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// Offsets of the fixed fields of a record (following its block size)
+static const size_t RefIDOffset = 0;
+static const size_t PositionOffset = 4;
+static const size_t NameLengthOffset = 8;
+static const size_t MapQualityOffset = 9;
+static const size_t CigarLengthOffset = 12;
+static const size_t FlagOffset = 14;
+static const size_t LengthOffset = 16;
+static const size_t NameOffset = 32;
+
+static const int UnmappedFlag = 0x4;
+static const int ReverseStrandFlag = 0x10;
+
+int BamRecord::RefID() const
+{
+	return getInt32(RefIDOffset);
+}
+
+int BamRecord::Position() const
+{
+	return getInt32(PositionOffset);
+}
+
+int BamRecord::MapQuality() const
+{
+	return (unsigned char)data[MapQualityOffset];
+}
+
+int BamRecord::Flag() const
+{
+	return getUInt16(FlagOffset);
+}
+
+bool BamRecord::IsMapped() const
+{
+	return (Flag() & UnmappedFlag) == 0;
+}
+
+bool BamRecord::IsReverseStrand() const
+{
+	return (Flag() & ReverseStrandFlag) != 0;
+}
+
+int BamRecord::Length() const
+{
+	return getInt32(LengthOffset);
+}
+
+const char *BamRecord::Name() const
+{
+	return &data[NameOffset];
+}
+
+string BamRecord::QueryBases() const
+{
+	static const char bases[] = "=ACMGRSVTWYHKDBN";
+	int n = Length();
+	const unsigned char *packed = (const unsigned char *)&data[sequenceOffset()];
+	string sequence(n, 'N');
+	for (int i = 0; i < n; i++)
+		sequence[i] = bases[(i & 1) ? packed[i >> 1] & 0xf : packed[i >> 1] >> 4];
+	return sequence;
+}
+
+// Records without qualities (stored as 0xff) give an empty string.
+string BamRecord::Qualities() const
+{
+	int n = Length();
+	const char *quality = &data[sequenceOffset() + (n + 1) / 2];
+	if (n == 0 || (unsigned char)quality[0] == 0xff)
+		return string();
+	string qualities(quality, n);
+	for (int i = 0; i < n; i++)
+		qualities[i] += 33;
+	return qualities;
+}
+
+bool BamRecord::GetTag(const string &tag, int &value) const
+{
+	size_t offset = findTag(tag.c_str());
+	if (offset == 0)
+		return false;
+	const char *v = &data[offset + 1];
+	switch (data[offset])
+	{
+	case 'c': value = *(const int8_t *)v; return true;
+	case 'C': value = *(const uint8_t *)v; return true;
+	case 's': { int16_t x; memcpy(&x, v, sizeof(x)); value = x; return true; }
+	case 'S': { uint16_t x; memcpy(&x, v, sizeof(x)); value = x; return true; }
+	case 'i': { int32_t x; memcpy(&x, v, sizeof(x)); value = x; return true; }
+	case 'I': { uint32_t x; memcpy(&x, v, sizeof(x)); value = x; return true; }
+	default: return false;
+	}
+}
+
+bool BamRecord::GetTag(const string &tag, string &value) const
+{
+	size_t offset = findTag(tag.c_str());
+	if (offset == 0 || data[offset] != 'Z')
+		return false;
+	value = &data[offset + 1];
+	return true;
+}
+
+void BamRecord::GetAlignment(BamAlignment &alignment) const
+{
+	alignment = BamAlignment();
+	alignment.Name = Name();
+	alignment.AlignmentFlag = Flag();
+	alignment.RefID = RefID();
+	alignment.Position = Position();
+	alignment.MapQuality = MapQuality();
+	alignment.QueryBases = QueryBases();
+	alignment.Qualities = Qualities();
+	alignment.Length = Length();
+	const char *end = &data[0] + data.size();
+	for (size_t offset = tagsOffset(); offset + 3 <= data.size(); )
+	{
+		string tag(&data[offset], 2);
+		const char *value = &data[offset + 2];
+		int number;
+		if (*value == 'Z')
+			alignment.AddTag(tag, "Z", string(value + 1));
+		else if (GetTag(tag, number))
+			alignment.AddTag(tag, "i", (int32_t)number);
+		size_t size = tagValueSize(value, end);
+		if (size == 0)
+			break;
+		offset += 3 + size;
+	}
+}
+
+void BamRecord::Swap(BamRecord &other)
+{
+	data.swap(other.data);
+}
+
+int32_t BamRecord::getInt32(size_t offset) const
+{
+	int32_t value;
+	memcpy(&value, &data[offset], sizeof(value));
+	return value;
+}
+
+uint16_t BamRecord::getUInt16(size_t offset) const
+{
+	uint16_t value;
+	memcpy(&value, &data[offset], sizeof(value));
+	return value;
+}
+
+size_t BamRecord::sequenceOffset() const
+{
+	return NameOffset + (unsigned char)data[NameLengthOffset] + 4 * getUInt16(CigarLengthOffset);
+}
+
+size_t BamRecord::tagsOffset() const
+{
+	int n = Length();
+	return sequenceOffset() + (n + 1) / 2 + n;
+}
+
+size_t BamRecord::findTag(const char *tag) const
+{
+	const char *end = &data[0] + data.size();
+	for (size_t offset = tagsOffset(); offset + 3 <= data.size(); )
+	{
+		const char *value = &data[offset + 2];
+		size_t size = tagValueSize(value, end);
+		if (size == 0)
+			return 0;
+		if (data[offset] == tag[0] && data[offset + 1] == tag[1])
+			return offset + 2;
+		offset += 3 + size;
+	}
+	return 0;
+}
+
+// Size of a tag value following its type at value, or 0 if the type is unknown or the value runs past end.
+size_t BamRecord::tagValueSize(const char *value, const char *end)
+{
+	size_t size = 0;
+	const char *v = value + 1;
+	switch (*value)
+	{
+	case 'A': case 'c': case 'C': size = 1; break;
+	case 's': case 'S': size = 2; break;
+	case 'i': case 'I': case 'f': size = 4; break;
+	case 'Z': case 'H':
+		{
+			const char *nul = (const char *)memchr(v, 0, end - v);
+			if (nul == NULL)
+				return 0;
+			size = nul - v + 1;
+			break;
+		}
+	case 'B':
+		{
+			if (end - v < 5 || *v == 'Z' || *v == 'H' || *v == 'B')
+				return 0;
+			int32_t count;
+			memcpy(&count, v + 1, sizeof(count));
+			size_t element = tagValueSize(v, end);
+			if (element == 0 || count < 0)
+				return 0;
+			size = 5 + element * count;
+			break;
+		}
+	default:
+		return 0;
+	}
+	return (size <= (size_t)(end - v) ? size : 0);
+}
+
+bool BamRecord::isValid() const
+{
+	if (data.size() < NameOffset)
+		return false;
+	int nameLength = (unsigned char)data[NameLengthOffset];
+	if (nameLength == 0 || data.size() < NameOffset + nameLength || data[NameOffset + nameLength - 1] != 0)
+		return false;
+	int n = Length();
+	return n >= 0 && sequenceOffset() + (size_t)(n + 1) / 2 + n <= data.size();
+}
+
+BamInput::BamInput()
+	: in(NULL)
+{
+}
+
+BamInput::~BamInput()
+{
+	Close();
+}
+
+bool BamInput::Open(const string &fileName)
+{
+	Close();
+	in = InputStream::Open(fileName);
+	if (in == NULL)
+		return false;
+	if (!readHeader())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void BamInput::Close()
+{
+	delete in;
+	in = NULL;
+	references.clear();
+	referenceIDs.clear();
+}
+
+bool BamInput::IsOpen() const
+{
+	return in != NULL;
+}
+
+bool BamInput::GetNextRecord(BamRecord &record)
+{
+	int32_t size;
+	if (in == NULL || !readInt32(size) || size < (int32_t)NameOffset)
+		return false;
+	record.data.resize(size);
+	return read(&record.data[0], size) && record.isValid();
+}
+
+const RefVector &BamInput::GetReferences() const
+{
+	return references;
+}
+
+int BamInput::GetReferenceCount() const
+{
+	return references.size();
+}
+
+int BamInput::GetReferenceID(const string &name) const
+{
+	map<string, int>::const_iterator it = referenceIDs.find(name);
+	return (it == referenceIDs.end() ? -1 : it->second);
+}
+
+bool BamInput::read(void *buf, size_t size)
+{
+	char *p = (char *)buf;
+	while (size > 0)
+	{
+		long long read = in->Read(p, size);
+		if (read <= 0)
+			return false;
+		p += read;
+		size -= read;
+	}
+	return true;
+}
+
+bool BamInput::readInt32(int32_t &value)
+{
+	return read(&value, sizeof(value));
+}
+
+// Reads the magic, skips the SAM header text and reads the reference names and lengths.
+bool BamInput::readHeader()
+{
+	char magic[4];
+	int32_t textLength, referenceCount;
+	if (!read(magic, sizeof(magic)) || memcmp(magic, "BAM\1", sizeof(magic)) || !readInt32(textLength) || textLength < 0)
+		return false;
+	vector<char> buffer(min(textLength, 1 << 16) + 1);
+	while (textLength > 0)
+	{
+		int32_t chunk = min(textLength, (int32_t)buffer.size());
+		if (!read(&buffer[0], chunk))
+			return false;
+		textLength -= chunk;
+	}
+	if (!readInt32(referenceCount) || referenceCount < 0)
+		return false;
+	for (int i = 0; i < referenceCount; i++)
+	{
+		int32_t nameLength;
+		RefData reference;
+		if (!readInt32(nameLength) || nameLength <= 0)
+			return false;
+		buffer.resize(nameLength);
+		if (!read(&buffer[0], nameLength) || !readInt32(reference.RefLength))
+			return false;
+		reference.RefName.assign(&buffer[0], nameLength - 1);
+		referenceIDs[reference.RefName] = i;
+		references.push_back(reference);
+	}
+	return true;
+}
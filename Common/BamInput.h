@@ -0,0 +1,116 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#ifndef _BAMINPUT_H
+#define _BAMINPUT_H
+
+#include "InputStream.h"
+#include "api/BamAlignment.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+using namespace BamTools;
+
+// A BAM record kept as read from the file. Fields and tags are decoded only when asked
+// for, so records whose bases, qualities or tags are not needed cost no more than their
+// copy from the inflated block. The file format is little-endian, as is the host.
+class BamRecord
+{
+public:
+	int RefID() const;
+	int Position() const;
+	int MapQuality() const;
+	int Flag() const;
+	bool IsMapped() const;
+	bool IsReverseStrand() const;
+	// Number of bases in the read.
+	int Length() const;
+	// Points into the record; valid until the record is read over.
+	const char *Name() const;
+	string QueryBases() const;
+	string Qualities() const;
+	// Integer tags of any width and string (Z) tags; false if the tag is absent or of another type.
+	bool GetTag(const string &tag, int &value) const;
+	bool GetTag(const string &tag, string &value) const;
+	// Decodes the whole record, with its integer and string tags.
+	void GetAlignment(BamAlignment &alignment) const;
+	void Swap(BamRecord &other);
+
+private:
+	int32_t getInt32(size_t offset) const;
+	uint16_t getUInt16(size_t offset) const;
+	size_t sequenceOffset() const;
+	size_t tagsOffset() const;
+	// Offset of the type of the given tag, or 0 if the record has no such tag.
+	size_t findTag(const char *tag) const;
+	static size_t tagValueSize(const char *value, const char *end);
+	bool isValid() const;
+
+private:
+	vector<char> data;
+
+	friend class BamInput;
+};
+
+// Reads BAM files record by record. Compressed blocks are inflated ahead on the worker
+// threads of BgzfInputStream (InputStream::Threads of them) while records are consumed.
+class BamInput
+{
+public:
+	BamInput();
+	~BamInput();
+
+public:
+	bool Open(const string &fileName);
+	void Close();
+	bool IsOpen() const;
+	// Reads the next record into record, reusing its memory. Returns false at the end of the file or on error.
+	bool GetNextRecord(BamRecord &record);
+
+public:
+	const RefVector &GetReferences() const;
+	int GetReferenceCount() const;
+	// Returns -1 for unknown reference names.
+	int GetReferenceID(const string &name) const;
+
+private:
+	BamInput(const BamInput &);
+	BamInput &operator= (const BamInput &);
+
+	bool read(void *buf, size_t size);
+	bool readInt32(int32_t &value);
+	bool readHeader();
+
+private:
+	InputStream *in;
+	RefVector references;
+	map<string, int> referenceIDs;
+};
+#endif
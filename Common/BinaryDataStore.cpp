@@ -0,0 +1,522 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "BinaryDataStore.h"
+#include "DataStore.h"
+#include "Helpers.h"
+#include "LinkSink.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const char BinaryDataStore::Magic[8] = { 'G', 'R', 'A', 'S', 'S', 'B', 'D', 'S' };
+
+BinaryDataStore::BinaryDataStore() : data(NULL), size(0), header(NULL)
+{
+}
+
+BinaryDataStore::~BinaryDataStore()
+{
+	Close();
+}
+
+bool BinaryDataStore::IsBinary(const char *data, long long size)
+{
+	return size >= (long long)sizeof(Magic) && !memcmp(data, Magic, sizeof(Magic));
+}
+
+long long BinaryDataStore::SectionSize(Section section, long long nContigs, long long nGroups, long long nLinks)
+{
+	switch (section)
+	{
+	case ContigLengths:
+		return nContigs * sizeof(int32_t);
+	case ContigComments:
+	case ContigSequences:
+		return nContigs * sizeof(int64_t);
+	case GroupNames:
+	case GroupDescriptions:
+		return nGroups * sizeof(int64_t);
+	case LinkFirst:
+	case LinkSecond:
+	case LinkGroup:
+	case LinkReadPairs:
+		return nLinks * sizeof(int32_t);
+	case LinkMean:
+	case LinkStd:
+	case LinkWeight:
+		return nLinks * sizeof(double);
+	case LinkFlags:
+		return nLinks * sizeof(uint8_t);
+	case LinkComments:
+	case LinkFirstReadPair:
+	case LinkLastReadPair:
+		return nLinks * sizeof(int64_t);
+	default:
+		return 0;
+	}
+}
+
+static void pad(FILE *out, long long &pos)
+{
+	static const char zeros[8] = { 0 };
+	long long n = (8 - pos % 8) % 8;
+	fwrite(zeros, 1, n, out);
+	pos += n;
+}
+
+template<class T> static void writeSection(FILE *out, long long &pos, const vector<T> &v)
+{
+	pad(out, pos);
+	if (!v.empty())
+		fwrite(&v[0], sizeof(T), v.size(), out);
+	pos += v.size() * sizeof(T);
+}
+
+static int64_t addString(string &strings, const char *s)
+{
+	int64_t offset = strings.size();
+	strings.append(s, strlen(s) + 1);
+	return offset;
+}
+
+// A section filled while the links are read. Links read from a LinkSink may not fit
+// in memory, so their columns are kept in an unlinked scratch file, a block at a time.
+template<class T> class Column
+{
+public:
+	Column() : file(NULL), size(0), failed(false) {};
+	~Column() { if (file != NULL) fclose(file); };
+
+	bool Open(const string &scratchPath)
+	{
+		string fileName = Helpers::TempFile(scratchPath);
+		file = fopen(fileName.c_str(), "w+b");
+		Helpers::RemoveFile(fileName);
+		return file != NULL;
+	}
+
+	void Reserve(long long n)
+	{
+		if (file == NULL)
+			values.reserve(n);
+	}
+
+	void Add(const T *v, size_t n)
+	{
+		values.insert(values.end(), v, v + n);
+		size += n;
+		if (file != NULL && values.size() >= BlockSize)
+			flush();
+	}
+
+	void Add(const T &v)
+	{
+		Add(&v, 1);
+	}
+
+	long long Size() const
+	{
+		return size;
+	}
+
+	bool Write(FILE *out, long long &pos)
+	{
+		if (file == NULL)
+		{
+			if (!values.empty())
+				fwrite(&values[0], sizeof(T), values.size(), out);
+		}
+		else
+		{
+			flush();
+			rewind(file);
+			vector<T> block(BlockSize);
+			for (long long left = size; left > 0 && !failed; )
+			{
+				size_t n = fread(&block[0], sizeof(T), min<long long>(left, BlockSize), file);
+				failed = n == 0 || fwrite(&block[0], sizeof(T), n, out) != n;
+				left -= n;
+			}
+		}
+		pos += size * sizeof(T);
+		return !failed;
+	}
+
+private:
+	void flush()
+	{
+		if (!values.empty() && fwrite(&values[0], sizeof(T), values.size(), file) != values.size())
+			failed = true;
+		values.clear();
+	}
+
+	static const size_t BlockSize = 1 << 16;
+	FILE *file;
+	vector<T> values;
+	long long size;
+	bool failed;
+};
+
+template<class T> static bool writeSection(FILE *out, long long &pos, Column<T> &column)
+{
+	pad(out, pos);
+	return column.Write(out, pos);
+}
+
+// Reads the links of a DataStore the way a LinkSink is read.
+class StoreLinks
+{
+public:
+	StoreLinks(const DataStore &store) : it(store.Begin()), end(store.End()) {};
+
+	bool Next(ContigLinkView &link)
+	{
+		if (it == end)
+			return false;
+		link = it->second;
+		it++;
+		return true;
+	}
+
+private:
+	DataStore::LinkMap::const_iterator it, end;
+};
+
+// Sequences are written last, one at a time, so lengths-only contigs are never held in memory as a whole.
+template<class Links> static bool writeStore(const DataStore &store, Links &links, long long nLinks, FILE *out, const string &scratchPath, bool spill)
+{
+	long long nContigs = store.ContigCount, nGroups = store.GroupCount;
+	string strings;
+	vector<int32_t> contigLengths(nContigs);
+	vector<int64_t> contigComments(nContigs), contigSequences(nContigs);
+	int64_t sequencesSize = 0;
+	for (int i = 0; i < nContigs; i++)
+	{
+		contigLengths[i] = store[i].Length();
+		contigComments[i] = addString(strings, store[i].Comment.c_str());
+		contigSequences[i] = sequencesSize;
+		sequencesSize += contigLengths[i] + 1;
+	}
+	vector<int64_t> groupNames(nGroups), groupDescriptions(nGroups);
+	for (int i = 0; i < nGroups; i++)
+	{
+		groupNames[i] = addString(strings, store.GetGroup(i).Name.c_str());
+		groupDescriptions[i] = addString(strings, store.GetGroup(i).Description.c_str());
+	}
+	Column<int32_t> first, second, group, readPairs;
+	Column<double> mean, std, weight;
+	Column<uint8_t> flags;
+	Column<int64_t> comments, firstReadPair, lastReadPair;
+	Column<char> linkStrings;
+	if (spill && !(first.Open(scratchPath) && second.Open(scratchPath) && group.Open(scratchPath) && readPairs.Open(scratchPath)
+		&& mean.Open(scratchPath) && std.Open(scratchPath) && weight.Open(scratchPath) && flags.Open(scratchPath)
+		&& comments.Open(scratchPath) && firstReadPair.Open(scratchPath) && lastReadPair.Open(scratchPath) && linkStrings.Open(scratchPath)))
+		return false;
+	first.Reserve(nLinks); second.Reserve(nLinks); group.Reserve(nLinks);
+	mean.Reserve(nLinks); std.Reserve(nLinks); weight.Reserve(nLinks);
+	flags.Reserve(nLinks); comments.Reserve(nLinks);
+	readPairs.Reserve(nLinks); firstReadPair.Reserve(nLinks); lastReadPair.Reserve(nLinks);
+	ContigLinkView link;
+	while (links.Next(link))
+	{
+		first.Add(link.First);
+		second.Add(link.Second);
+		mean.Add(link.Mean);
+		std.Add(link.Std);
+		flags.Add((link.EqualOrientation ? BinaryDataStore::EqualOrientation : 0) | (link.ForwardOrder ? BinaryDataStore::ForwardOrder : 0) | (link.Ambiguous ? BinaryDataStore::Ambiguous : 0));
+		weight.Add(link.Weight);
+		group.Add(link.GetGroupID());
+		comments.Add(strings.size() + linkStrings.Size());
+		linkStrings.Add(link.Comment, strlen(link.Comment) + 1);
+		readPairs.Add(link.Provenance.Count);
+		firstReadPair.Add(link.Provenance.First);
+		lastReadPair.Add(link.Provenance.Last);
+	}
+	if (first.Size() != nLinks)
+		return false;
+
+	BinaryDataStore::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, BinaryDataStore::Magic, sizeof(BinaryDataStore::Magic));
+	header.Version = BinaryDataStore::Version;
+	header.HeaderSize = sizeof(header);
+	header.ContigCount = nContigs;
+	header.GroupCount = nGroups;
+	header.LinkCount = nLinks;
+	long long pos = sizeof(header);
+	for (int s = 0; s < BinaryDataStore::SectionCount; s++)
+	{
+		pos += (8 - pos % 8) % 8;
+		header.Offsets[s] = pos;
+		if (s == BinaryDataStore::Strings)
+			pos += strings.size() + linkStrings.Size();
+		else if (s == BinaryDataStore::Sequences)
+			pos += sequencesSize;
+		else
+			pos += BinaryDataStore::SectionSize((BinaryDataStore::Section)s, nContigs, nGroups, nLinks);
+	}
+	header.FileSize = pos;
+
+	pos = 0;
+	if (fwrite(&header, sizeof(header), 1, out) != 1)
+		return false;
+	pos += sizeof(header);
+	writeSection(out, pos, contigLengths);
+	writeSection(out, pos, contigComments);
+	writeSection(out, pos, contigSequences);
+	writeSection(out, pos, groupNames);
+	writeSection(out, pos, groupDescriptions);
+	bool success = writeSection(out, pos, first) && writeSection(out, pos, second) && writeSection(out, pos, mean)
+		&& writeSection(out, pos, std) && writeSection(out, pos, flags) && writeSection(out, pos, weight)
+		&& writeSection(out, pos, group) && writeSection(out, pos, comments) && writeSection(out, pos, readPairs)
+		&& writeSection(out, pos, firstReadPair) && writeSection(out, pos, lastReadPair);
+	if (!success)
+		return false;
+	pad(out, pos);
+	fwrite(strings.data(), 1, strings.size(), out);
+	pos += strings.size();
+	if (!linkStrings.Write(out, pos))
+		return false;
+	pad(out, pos);
+	string seq;
+	for (int i = 0; i < nContigs; i++)
+	{
+		if (!store[i].GetNucleotides(seq) || (int)seq.length() != contigLengths[i])
+			return false;
+		fwrite(seq.c_str(), 1, seq.length() + 1, out);
+	}
+	return !ferror(out);
+}
+
+bool BinaryDataStore::Write(const DataStore &store, FILE *out)
+{
+	StoreLinks links(store);
+	return writeStore(store, links, store.LinkCount, out, "", false);
+}
+
+// The links are taken from the sink instead of the store; if the sink spilled, so do the link sections.
+bool BinaryDataStore::Write(const DataStore &store, LinkSink &links, FILE *out)
+{
+	if (!links.Rewind())
+		return false;
+	return writeStore(store, links, links.Size(), out, links.ScratchPath(), links.Runs() > 0);
+}
+
+bool BinaryDataStore::Open(const string &fileName)
+{
+	if (data != NULL)
+		return false;
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat s;
+	if (fstat(fd, &s) != 0 || !S_ISREG(s.st_mode) || s.st_size < (off_t)sizeof(Header))
+	{
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	data = (const char *)map;
+	size = s.st_size;
+	header = (const Header *)data;
+	if (!validate())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool BinaryDataStore::Close()
+{
+	if (data == NULL)
+		return false;
+	munmap((void *)data, size);
+	data = NULL;
+	header = NULL;
+	size = 0;
+	return true;
+}
+
+bool BinaryDataStore::IsOpen() const
+{
+	return data != NULL;
+}
+
+// Checks that all sections lie within the file, all string offsets point into their blobs and
+// all links refer to existing contigs and groups with a positive weight, so that a truncated
+// or foreign file cannot be read out of bounds.
+bool BinaryDataStore::validate() const
+{
+	if (memcmp(header->Magic, Magic, sizeof(Magic)) || header->Version != Version || header->HeaderSize != sizeof(Header) || header->FileSize != size)
+		return false;
+	if (header->ContigCount < 0 || header->GroupCount < 0 || header->LinkCount < 0 || header->LinkCount > 0x7fffffff || header->ContigCount > 0x7fffffff || header->GroupCount > 0x7fffffff)
+		return false;
+	for (int s = 0; s < SectionCount; s++)
+	{
+		long long end = (s + 1 < SectionCount ? header->Offsets[s + 1] : size);
+		if (header->Offsets[s] < (long long)sizeof(Header) || header->Offsets[s] % 8 || header->Offsets[s] > end)
+			return false;
+		if (end - header->Offsets[s] < SectionSize((Section)s, header->ContigCount, header->GroupCount, header->LinkCount))
+			return false;
+	}
+	long long stringsSize = header->Offsets[Sequences] - header->Offsets[Strings];
+	long long sequencesSize = size - header->Offsets[Sequences];
+	const char *strings = section<char>(Strings);
+	while (stringsSize > 0 && strings[stringsSize - 1] != 0)
+		stringsSize--;
+	const Section stringSections[] = { ContigComments, GroupNames, GroupDescriptions, LinkComments };
+	const long long stringCounts[] = { header->ContigCount, header->GroupCount, header->GroupCount, header->LinkCount };
+	for (int s = 0; s < 4; s++)
+	{
+		const int64_t *offsets = section<int64_t>(stringSections[s]);
+		for (long long i = 0; i < stringCounts[s]; i++)
+			if (offsets[i] < 0 || offsets[i] >= stringsSize)
+				return false;
+	}
+	const int32_t *lengths = section<int32_t>(ContigLengths);
+	const int64_t *sequences = section<int64_t>(ContigSequences);
+	for (long long i = 0; i < header->ContigCount; i++)
+		if (lengths[i] < 0 || sequences[i] < 0 || sequences[i] + lengths[i] >= sequencesSize || data[header->Offsets[Sequences] + sequences[i] + lengths[i]] != 0)
+			return false;
+	const int32_t *first = section<int32_t>(LinkFirst), *second = section<int32_t>(LinkSecond), *group = section<int32_t>(LinkGroup);
+	const double *weight = section<double>(LinkWeight);
+	for (long long i = 0; i < header->LinkCount; i++)
+		if (first[i] < 0 || first[i] >= header->ContigCount || second[i] < 0 || second[i] >= header->ContigCount || group[i] < 0 || group[i] >= header->GroupCount || !(weight[i] > 0))
+			return false;
+	return true;
+}
+
+int BinaryDataStore::ContigCount() const
+{
+	return header->ContigCount;
+}
+
+int BinaryDataStore::GroupCount() const
+{
+	return header->GroupCount;
+}
+
+int BinaryDataStore::LinkCount() const
+{
+	return header->LinkCount;
+}
+
+const int32_t *BinaryDataStore::GetContigLengths() const
+{
+	return section<int32_t>(ContigLengths);
+}
+
+const char *BinaryDataStore::GetContigComment(int i) const
+{
+	return section<char>(Strings) + section<int64_t>(ContigComments)[i];
+}
+
+const char *BinaryDataStore::GetContigSequence(int i) const
+{
+	return section<char>(Sequences) + section<int64_t>(ContigSequences)[i];
+}
+
+long long BinaryDataStore::GetContigSequenceOffset(int i) const
+{
+	return header->Offsets[Sequences] + section<int64_t>(ContigSequences)[i];
+}
+
+const char *BinaryDataStore::GetGroupName(int i) const
+{
+	return section<char>(Strings) + section<int64_t>(GroupNames)[i];
+}
+
+const char *BinaryDataStore::GetGroupDescription(int i) const
+{
+	return section<char>(Strings) + section<int64_t>(GroupDescriptions)[i];
+}
+
+const int32_t *BinaryDataStore::GetLinkFirst() const
+{
+	return section<int32_t>(LinkFirst);
+}
+
+const int32_t *BinaryDataStore::GetLinkSecond() const
+{
+	return section<int32_t>(LinkSecond);
+}
+
+const double *BinaryDataStore::GetLinkMean() const
+{
+	return section<double>(LinkMean);
+}
+
+const double *BinaryDataStore::GetLinkStd() const
+{
+	return section<double>(LinkStd);
+}
+
+const uint8_t *BinaryDataStore::GetLinkFlags() const
+{
+	return section<uint8_t>(LinkFlags);
+}
+
+const double *BinaryDataStore::GetLinkWeight() const
+{
+	return section<double>(LinkWeight);
+}
+
+const int32_t *BinaryDataStore::GetLinkGroup() const
+{
+	return section<int32_t>(LinkGroup);
+}
+
+const char *BinaryDataStore::GetLinkComment(int i) const
+{
+	return section<char>(Strings) + section<int64_t>(LinkComments)[i];
+}
+
+const int32_t *BinaryDataStore::GetLinkReadPairs() const
+{
+	return section<int32_t>(LinkReadPairs);
+}
+
+const int64_t *BinaryDataStore::GetLinkFirstReadPair() const
+{
+	return section<int64_t>(LinkFirstReadPair);
+}
+
+const int64_t *BinaryDataStore::GetLinkLastReadPair() const
+{
+	return section<int64_t>(LinkLastReadPair);
+}
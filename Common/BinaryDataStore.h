@@ -0,0 +1,153 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+/*
+ * Binary DataStore file format. Unlike the text format it needs no parsing:
+ * the file is mapped and every table is used in place. All values are stored
+ * in native (little endian) byte order and every section starts at a multiple
+ * of 8 bytes.
+ *
+ *   header     magic, version, table sizes and section offsets
+ *   contigs    length, comment and sequence offset per contig
+ *   groups     name and description offset per group
+ *   links      one column per field: first, second, mean, std, flags, weight,
+ *              group, comment offset and provenance (read pair count, first
+ *              and last read pair id), ordered as in DataStore::LinkMap
+ *   strings    zero-terminated comments, names and descriptions
+ *   sequences  zero-terminated contig sequences
+ */
+
+#ifndef _BINARYDATASTORE_H
+#define _BINARYDATASTORE_H
+
+#include <cstdio>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+class DataStore;
+class LinkSink;
+
+class BinaryDataStore
+{
+public:
+	enum Section
+	{
+		ContigLengths,
+		ContigComments,
+		ContigSequences,
+		GroupNames,
+		GroupDescriptions,
+		LinkFirst,
+		LinkSecond,
+		LinkMean,
+		LinkStd,
+		LinkFlags,
+		LinkWeight,
+		LinkGroup,
+		LinkComments,
+		LinkReadPairs,
+		LinkFirstReadPair,
+		LinkLastReadPair,
+		Strings,
+		Sequences,
+		SectionCount
+	};
+
+	enum LinkFlag
+	{
+		EqualOrientation = 1,
+		ForwardOrder = 2,
+		Ambiguous = 4
+	};
+
+	struct Header
+	{
+		char Magic[8];
+		uint32_t Version;
+		uint32_t HeaderSize;
+		int64_t ContigCount;
+		int64_t GroupCount;
+		int64_t LinkCount;
+		int64_t FileSize;
+		int64_t Offsets[SectionCount];
+	};
+
+	static const char Magic[8];
+	static const uint32_t Version = 2;
+
+public:
+	BinaryDataStore();
+	virtual ~BinaryDataStore();
+
+public:
+	// Checks the magic bytes at the start of a file's contents.
+	static bool IsBinary(const char *data, long long size);
+	static bool Write(const DataStore &store, FILE *out);
+	// Writes the contigs and groups of store with the links collected in a sink.
+	static bool Write(const DataStore &store, LinkSink &links, FILE *out);
+	// Size of a section in a file with the given table sizes.
+	static long long SectionSize(Section section, long long nContigs, long long nGroups, long long nLinks);
+	bool Open(const string &fileName);
+	bool Close();
+	bool IsOpen() const;
+
+	int ContigCount() const;
+	int GroupCount() const;
+	int LinkCount() const;
+	const int32_t *GetContigLengths() const;
+	const char *GetContigComment(int i) const;
+	const char *GetContigSequence(int i) const;
+	// Position of the sequence of contig i in the file, for FastAIndex.
+	long long GetContigSequenceOffset(int i) const;
+	const char *GetGroupName(int i) const;
+	const char *GetGroupDescription(int i) const;
+	const int32_t *GetLinkFirst() const;
+	const int32_t *GetLinkSecond() const;
+	const double *GetLinkMean() const;
+	const double *GetLinkStd() const;
+	const uint8_t *GetLinkFlags() const;
+	const double *GetLinkWeight() const;
+	const int32_t *GetLinkGroup() const;
+	const char *GetLinkComment(int i) const;
+	const int32_t *GetLinkReadPairs() const;
+	const int64_t *GetLinkFirstReadPair() const;
+	const int64_t *GetLinkLastReadPair() const;
+
+private:
+	BinaryDataStore(const BinaryDataStore &);
+	BinaryDataStore &operator= (const BinaryDataStore &);
+	bool validate() const;
+	template<class T> const T *section(Section s) const { return (const T *)(data + header->Offsets[s]); }
+
+private:
+	const char *data;
+	long long size;
+	const Header *header;
+};
+#endif
@@ -33,6 +33,10 @@
 #include <utility>
 #include <algorithm>
 #include <set>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <thread>
 
 #include <iostream>
 
@@ -43,8 +47,86 @@ int Contig::GetID() const
 	return id;
 }
 
-ContigLink::ContigLink(int first, int second, double mean, double std, bool equalOrientation, bool forwardOrder, double weight, const string &comment)
-	: First(first), Second(second), Mean(mean), Std(std), EqualOrientation(equalOrientation), ForwardOrder(forwardOrder), Weight(weight), Ambiguous(false), Comment(comment), groupId(0)
+Contig::Contig(const shared_ptr<const FastAIndex> &source, int entry)
+	: Comment((*source)[entry].Comment), id(0), length((*source)[entry].Length), source(source), sourceEntry(entry)
+{
+}
+
+int Contig::Length() const
+{
+	return (source ? length : Sequence.Length());
+}
+
+bool Contig::HasSequence() const
+{
+	return !source;
+}
+
+bool Contig::GetNucleotides(string &nucleotides) const
+{
+	if (source)
+		return source->Fetch(sourceEntry, nucleotides);
+	Sequence.Unpack(nucleotides);
+	return true;
+}
+
+// First word of the comment, as in FastASequence::Name.
+string Contig::Name() const
+{
+	size_t start = Comment.find_first_not_of(" \t\r\n");
+	if (start == string::npos)
+		return string();
+	size_t end = Comment.find_first_of(" \t\r\n", start);
+	return Comment.substr(start, end == string::npos ? string::npos : end - start);
+}
+
+// Throws if the sequence of a lengths-only contig can no longer be read.
+FastASequence Contig::GetFastA(bool reverseComplement) const
+{
+	FastASequence seq;
+	seq.Comment = Comment;
+	if (source)
+	{
+		if (!source->Fetch(sourceEntry, seq.Nucleotides))
+			throw runtime_error("Contig : unable to read sequence of " + Comment);
+		if (reverseComplement)
+			seq.ReverseCompelement();
+	}
+	else if (reverseComplement)
+	{
+		PackedSequence reversed(Sequence);
+		reversed.ReverseComplement();
+		reversed.Unpack(seq.Nucleotides);
+	}
+	else
+		Sequence.Unpack(seq.Nucleotides);
+	return seq;
+}
+
+bool LinkProvenance::IsRecorded() const
+{
+	return First >= 0;
+}
+
+void LinkProvenance::Join(const LinkProvenance &other)
+{
+	Count += other.Count;
+	if (!other.IsRecorded())
+		return;
+	if (!IsRecorded())
+	{
+		First = other.First;
+		Last = other.Last;
+	}
+	else
+	{
+		First = min(First, other.First);
+		Last = max(Last, other.Last);
+	}
+}
+
+ContigLink::ContigLink(int first, int second, double mean, double std, bool equalOrientation, bool forwardOrder, double weight, const string &comment, const LinkProvenance &provenance)
+	: First(first), Second(second), Mean(mean), Std(std), EqualOrientation(equalOrientation), ForwardOrder(forwardOrder), Weight(weight), Ambiguous(false), Comment(comment), Provenance(provenance), groupId(0)
 {
 }
 
@@ -61,45 +143,386 @@ bool ContigLink::operator< (const ContigLink &other)
 	return false;
 }
 
+ContigLink::ContigLink(const ContigLinkView &view)
+	: First(view.First), Second(view.Second), Mean(view.Mean), Std(view.Std), EqualOrientation(view.EqualOrientation), ForwardOrder(view.ForwardOrder), Weight(view.Weight), Ambiguous(view.Ambiguous), Comment(view.Comment), Provenance(view.Provenance), groupId(view.GetGroupID())
+{
+}
+
 int ContigLink::GetGroupID() const
 {
 	return groupId;
 }
 
+void LinkTable::const_iterator::load() const
+{
+	if (loaded == index)
+		return;
+	entry.first = pair<int,int>(table->first[index], table->second[index]);
+	table->view(index, entry.second);
+	loaded = index;
+}
+
+LinkTable::LinkTable() : sorted(true), indexed(false), comments(1, '\0')
+{
+}
+
+int LinkTable::Size() const
+{
+	return first.size();
+}
+
+void LinkTable::Clear()
+{
+	LinkTable empty;
+	Swap(empty);
+}
+
+void LinkTable::Swap(LinkTable &other)
+{
+	first.swap(other.first);
+	second.swap(other.second);
+	group.swap(other.group);
+	mean.swap(other.mean);
+	std.swap(other.std);
+	weight.swap(other.weight);
+	flags.swap(other.flags);
+	comment.swap(other.comment);
+	pairs.swap(other.pairs);
+	firstPair.swap(other.firstPair);
+	lastPair.swap(other.lastPair);
+	rows.swap(other.rows);
+	comments.swap(other.comments);
+	swap(sorted, other.sorted);
+	swap(indexed, other.indexed);
+}
+
+void LinkTable::Reserve(int n)
+{
+	first.reserve(n);
+	second.reserve(n);
+	group.reserve(n);
+	mean.reserve(n);
+	std.reserve(n);
+	weight.reserve(n);
+	flags.reserve(n);
+	comment.reserve(n);
+	pairs.reserve(n);
+	firstPair.reserve(n);
+	lastPair.reserve(n);
+}
+
+void LinkTable::add(int first, int second, double mean, double std, int flags, double weight, int groupId, const LinkProvenance &provenance, const char *comment, size_t commentLength)
+{
+	if (sorted && !this->first.empty() && (first < this->first.back() || (first == this->first.back() && second < this->second.back())))
+		sorted = false;
+	indexed = false;
+	this->first.push_back(first);
+	this->second.push_back(second);
+	this->mean.push_back(mean);
+	this->std.push_back(std);
+	this->weight.push_back(weight);
+	this->flags.push_back(flags);
+	this->group.push_back(groupId);
+	pairs.push_back(provenance.Count);
+	firstPair.push_back(provenance.First);
+	lastPair.push_back(provenance.Last);
+	if (commentLength == 0)
+		this->comment.push_back(0);
+	else
+	{
+		this->comment.push_back(comments.size());
+		comments.append(comment, commentLength);
+		comments.push_back('\0');
+	}
+}
+
+void LinkTable::Add(int groupId, const ContigLink &link)
+{
+	int flags = (link.EqualOrientation ? EqualOrientation : 0) | (link.ForwardOrder ? ForwardOrder : 0) | (link.Ambiguous ? Ambiguous : 0);
+	add(link.First, link.Second, link.Mean, link.Std, flags, link.Weight, groupId, link.Provenance, link.Comment.c_str(), link.Comment.length());
+}
+
+void LinkTable::Add(int groupId, const ContigLinkView &link)
+{
+	int flags = (link.EqualOrientation ? EqualOrientation : 0) | (link.ForwardOrder ? ForwardOrder : 0) | (link.Ambiguous ? Ambiguous : 0);
+	add(link.First, link.Second, link.Mean, link.Std, flags, link.Weight, groupId, link.Provenance, link.Comment, strlen(link.Comment));
+}
+
+// Copies the links of other in the order they are stored; the result is sorted on the next read.
+void LinkTable::Append(const LinkTable &other, int groupOffset, int64_t readPairOffset)
+{
+	int n = other.Size();
+	Reserve(Size() + n);
+	for (int i = 0; i < n; i++)
+	{
+		const char *text = other.comments.c_str() + other.comment[i];
+		LinkProvenance provenance(other.pairs[i], other.firstPair[i], other.lastPair[i]);
+		if (provenance.IsRecorded())
+		{
+			provenance.First += readPairOffset;
+			provenance.Last += readPairOffset;
+		}
+		add(other.first[i], other.second[i], other.mean[i], other.std[i], other.flags[i], other.weight[i], other.group[i] + groupOffset, provenance, text, strlen(text));
+	}
+}
+
+int64_t LinkTable::ReadPairEnd() const
+{
+	int64_t end = 0;
+	for (int i = 0; i < Size(); i++)
+		if (firstPair[i] >= 0 && lastPair[i] >= end)
+			end = lastPair[i] + 1;
+	return end;
+}
+
+LinkTable::const_iterator LinkTable::Begin() const
+{
+	sort();
+	return const_iterator(this, 0);
+}
+
+LinkTable::const_iterator LinkTable::End() const
+{
+	return const_iterator(this, Size());
+}
+
+pair<LinkTable::const_iterator, LinkTable::const_iterator> LinkTable::Range(int i, int j) const
+{
+	sort();
+	buildRows();
+	if (i < 0 || i + 1 >= (int)rows.size())
+		return make_pair(End(), End());
+	vector<int>::const_iterator begin = second.begin() + rows[i], end = second.begin() + rows[i + 1];
+	int lo = lower_bound(begin, end, j) - second.begin();
+	int hi = upper_bound(begin, end, j) - second.begin();
+	return make_pair(const_iterator(this, lo), const_iterator(this, hi));
+}
+
+pair<LinkTable::const_iterator, LinkTable::const_iterator> LinkTable::Range(int i) const
+{
+	sort();
+	buildRows();
+	if (i < 0 || i + 1 >= (int)rows.size())
+		return make_pair(End(), End());
+	return make_pair(const_iterator(this, rows[i]), const_iterator(this, rows[i + 1]));
+}
+
+// Positions are those of the sorted table, as seen through Begin().
+class RemovedAt
+{
+public:
+	RemovedAt(const vector<bool> &removed) : removed(removed) {};
+	bool operator() (int position, const ContigLinkView &) const { return removed[position]; };
+
+private:
+	const vector<bool> &removed;
+};
+
+int LinkTable::Remove(const vector<bool> &removed)
+{
+	RemovedAt predicate(removed);
+	return RemoveIf(predicate);
+}
+
+void LinkTable::view(int i, ContigLinkView &link) const
+{
+	link.First = first[i];
+	link.Second = second[i];
+	link.Mean = mean[i];
+	link.Std = std[i];
+	link.Weight = weight[i];
+	link.EqualOrientation = (flags[i] & EqualOrientation) != 0;
+	link.ForwardOrder = (flags[i] & ForwardOrder) != 0;
+	link.Ambiguous = (flags[i] & Ambiguous) != 0;
+	link.Comment = comments.c_str() + comment[i];
+	link.Provenance = LinkProvenance(pairs[i], firstPair[i], lastPair[i]);
+	link.groupId = group[i];
+}
+
+// Moves link from to position to (to <= from), copying its comment into keptComments.
+void LinkTable::move(int from, int to, string &keptComments)
+{
+	first[to] = first[from];
+	second[to] = second[from];
+	group[to] = group[from];
+	mean[to] = mean[from];
+	std[to] = std[from];
+	weight[to] = weight[from];
+	flags[to] = flags[from];
+	pairs[to] = pairs[from];
+	firstPair[to] = firstPair[from];
+	lastPair[to] = lastPair[from];
+	if (comment[from] == 0)
+		comment[to] = 0;
+	else
+	{
+		const char *text = comments.c_str() + comment[from];
+		comment[to] = keptComments.size();
+		keptComments.append(text, strlen(text) + 1);
+	}
+}
+
+void LinkTable::resize(int n)
+{
+	first.resize(n);
+	second.resize(n);
+	group.resize(n);
+	mean.resize(n);
+	std.resize(n);
+	weight.resize(n);
+	flags.resize(n);
+	comment.resize(n);
+	pairs.resize(n);
+	firstPair.resize(n);
+	lastPair.resize(n);
+}
+
+void LinkTable::Normalize()
+{
+	int n = Size();
+	for (int i = 0; i < n; i++)
+		if (first[i] > second[i])
+		{
+			swap(first[i], second[i]);
+			if (flags[i] & EqualOrientation)
+				flags[i] ^= ForwardOrder;
+			sorted = indexed = false;
+		}
+}
+
+void LinkTable::BuildIndex() const
+{
+	sort();
+	buildRows();
+}
+
+size_t LinkTable::MemoryUsage() const
+{
+	return (first.capacity() + second.capacity() + group.capacity() + pairs.capacity() + rows.capacity()) * sizeof(int)
+		+ (mean.capacity() + std.capacity() + weight.capacity()) * sizeof(double)
+		+ flags.capacity() * sizeof(uint8_t) + (comment.capacity() + firstPair.capacity() + lastPair.capacity()) * sizeof(int64_t) + comments.capacity();
+}
+
+// Stable counting sort of the positions in by key.
+static void countingSort(const vector<int> &key, int range, const vector<int> &in, vector<int> &out)
+{
+	vector<int> start(range + 1, 0);
+	int n = in.size();
+	for (int i = 0; i < n; i++)
+		start[key[in[i]] + 1]++;
+	for (int i = 0; i < range; i++)
+		start[i + 1] += start[i];
+	for (int i = 0; i < n; i++)
+		out[start[key[in[i]]]++] = in[i];
+}
+
+template<class T> void LinkTable::permute(vector<T> &column, const vector<int> &order)
+{
+	vector<T> result(order.size());
+	for (size_t i = 0; i < order.size(); i++)
+		result[i] = column[order[i]];
+	column.swap(result);
+}
+
+// Contig ids are small non-negative numbers, so two stable counting sort passes (second,
+// then first contig) order the table in linear time.
+void LinkTable::sort() const
+{
+	if (sorted)
+		return;
+	int n = Size();
+	int range = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (first[i] < 0 || second[i] < 0)
+			throw exception();
+		range = max(range, max(first[i], second[i]) + 1);
+	}
+	vector<int> order(n), byFirst(n);
+	for (int i = 0; i < n; i++)
+		order[i] = i;
+	countingSort(second, range, order, byFirst);
+	countingSort(first, range, byFirst, order);
+	permute(first, order);
+	permute(second, order);
+	permute(group, order);
+	permute(mean, order);
+	permute(std, order);
+	permute(weight, order);
+	permute(flags, order);
+	permute(comment, order);
+	permute(pairs, order);
+	permute(firstPair, order);
+	permute(lastPair, order);
+	sorted = true;
+	indexed = false;
+}
+
+void LinkTable::buildRows() const
+{
+	if (indexed)
+		return;
+	int n = Size();
+	int nRows = (n > 0 ? first.back() + 1 : 0);
+	rows.assign(nRows + 1, 0);
+	for (int i = 0; i < n; i++)
+		rows[first[i] + 1]++;
+	for (int i = 0; i < nRows; i++)
+		rows[i + 1] += rows[i];
+	indexed = true;
+}
+
 int LinkGroup::GetID() const
 {
 	return id;
 }
 
-const Contig &DataStore::operator[] (int i) const
+static int defaultThreads()
 {
-	return contigs[i];
+	int n = thread::hardware_concurrency();
+	return (n > 0 ? n : 1);
 }
 
-const DataStore::LinkRange DataStore::operator() (int i, int j) const
+int DataStore::Threads = defaultThreads();
+
+shared_ptr<const DataStore> DataStore::Snapshot(const DataStore &store)
 {
-	pair<int,int> query(i, j);
-	return links.equal_range(query);
+	shared_ptr<DataStore> snapshot(new DataStore(store));
+	snapshot->links.BuildIndex();
+	return snapshot;
 }
 
-DataStore::LinkMap::const_iterator DataStore::Begin() const
+shared_ptr<const DataStore> DataStore::Snapshot(DataStore &&store)
 {
-	return links.begin();
+	shared_ptr<DataStore> snapshot(new DataStore(std::move(store)));
+	store = DataStore();
+	snapshot->links.BuildIndex();
+	return snapshot;
 }
 
-DataStore::LinkMap::const_iterator DataStore::End() const
+const Contig &DataStore::operator[] (int i) const
+{
+	return contigs[i];
+}
+
+const DataStore::LinkRange DataStore::operator() (int i, int j) const
 {
-	return links.end();
+	return links.Range(i, j);
 }
 
-DataStore::LinkMap::iterator DataStore::Begin()
+const DataStore::LinkRange DataStore::operator() (int i) const
+{
+	return links.Range(i);
+}
+
+DataStore::LinkMap::const_iterator DataStore::Begin() const
 {
-	return links.begin();
+	return links.Begin();
 }
 
-DataStore::LinkMap::iterator DataStore::End()
+DataStore::LinkMap::const_iterator DataStore::End() const
 {
-	return links.end();
+	return links.End();
 }
 
 const LinkGroup &DataStore::GetGroup(int id) const
@@ -111,46 +534,84 @@ vector<FastASequence> DataStore::GetContigs() const
 {
     vector<FastASequence> faContigs(ContigCount);
     for (int i = 0; i < ContigCount; i++)
-        faContigs[i] = contigs[i].Sequence;
+        faContigs[i] = contigs[i].GetFastA();
     return faContigs;
 }
 
 int DataStore::AddContig(const Contig &contig)
 {
 	contigs.push_back(contig);
-	int id = contigs[ContigCount].id = ContigCount++;
-	return id;
+	contigs[ContigCount].id = ContigCount;
+	return ContigCount++;
 }
 
 int DataStore::AddGroup(const LinkGroup &group)
 {
 	groups.push_back(group);
-	return groups[GroupCount].id = GroupCount++;
+	groups[GroupCount].id = GroupCount;
+	return GroupCount++;
 }
 
-DataStore::LinkMap::const_iterator DataStore::AddLink(int groupId, const ContigLink &link)
+void DataStore::AddLink(int groupId, const ContigLink &link)
 {
 	if (groupId >= GroupCount)
 		throw exception();
-	LinkCount++;
-	//fprintf(stderr, "Linked: d(%i,%i) = %8.2f; orientation: %8s; order: %7s.\n", link.First, link.Second, link.Mean, (link.EqualOrientation ? "equal" : "opposite"), (link.ForwardOrder ? "forward" : "reverse"));
-	pair<int,int> query(link.First, link.Second);
-	LinkMap::iterator it = links.insert(pair<pair<int,int>,ContigLink>(query, link));
-	it->second.groupId = groupId;
-	return it;
+	links.Add(groupId, link);
+	LinkCount = links.Size();
 }
 
-bool DataStore::ReadContigs(const string &fileName)
+// The group ids of the links must refer to groups of this store; they are not checked.
+void DataStore::AddLinks(const LinkTable &links)
 {
-	FastAReader reader;
-	FastASequence seq;
+	this->links.Append(links);
+	LinkCount = this->links.Size();
+}
+
+bool DataStore::Merge(const DataStore &other)
+{
+	if (other.ContigCount != ContigCount)
+		return false;
+	for (int i = 0; i < ContigCount; i++)
+		if (other.contigs[i].Length() != contigs[i].Length() || other.contigs[i].Comment != contigs[i].Comment)
+			return false;
+	int groupOffset = GroupCount;
+	for (int i = 0; i < other.GroupCount; i++)
+		AddGroup(other.groups[i]);
+	links.Append(other.links, groupOffset, ReadPairEnd());
+	LinkCount = links.Size();
+	return true;
+}
+
+int64_t DataStore::ReadPairEnd() const
+{
+	return links.ReadPairEnd();
+}
+
+bool DataStore::ReadContigs(const string &fileName, bool lengthsOnly)
+{
+	if (lengthsOnly)
+	{
+		shared_ptr<FastAIndex> index(new FastAIndex());
+		// input that cannot be read at random is loaded as a whole
+		if (index->Build(fileName))
+		{
+			for (int i = 0; i < index->Count(); i++)
+				AddContig(Contig(index, i));
+			return index->Count() != 0;
+		}
+	}
+	MappedFastAReader reader;
+	FastARecord record;
 	if (!reader.Open(fileName))
 		return false;
 	
 	int read = 0;
-	while (reader.Read(seq))
+	contigs.reserve(contigs.size() + reader.NumReads());
+	Contig contig;
+	while (reader.Next(record))
 	{
-		Contig contig(seq);
+		contig.Comment.assign(record.Header, record.HeaderLength);
+		record.GetNucleotides(contig.Sequence);
 		AddContig(contig);
 		read++;
 	}
@@ -160,137 +621,454 @@ bool DataStore::ReadContigs(const string &fileName)
 
 void DataStore::Sort()
 {
-	vector<ContigLink> vec;
-	for (LinkMap::iterator it = links.begin(); it != links.end(); it++)
+	links.Normalize();
+}
+
+// Positions of a run still to be bundled. A Fenwick tree finds the k-th remaining position
+// and skip pointers the next remaining one, both in (amortised) logarithmic time.
+class RemainingPositions
+{
+public:
+	RemainingPositions() : n(0), count(0), top(1) {};
+
+public:
+	// Starts over with all positions 0 .. n-1 remaining.
+	void Reset(int n)
+	{
+		this->n = count = n;
+		tree.resize(n + 1);
+		next.resize(n + 1);
+		for (int i = 1; i <= n; i++)
+			tree[i] = i & -i;
+		for (int i = 0; i <= n; i++)
+			next[i] = i;
+		for (top = 1; top * 2 <= n; top *= 2)
+			;
+	};
+
+	int Count() const
+	{
+		return count;
+	};
+
+	// Position of the k-th (from 0) remaining element.
+	int Find(int k) const
+	{
+		int pos = 0;
+		for (int step = top; step > 0; step /= 2)
+			if (pos + step <= n && tree[pos + step] <= k)
+			{
+				pos += step;
+				k -= tree[pos];
+			}
+		return pos;
+	};
+
+	// First remaining position at or after i, n if there is none.
+	int Next(int i)
 	{
-		if (it->first.first > it->first.second)
+		int r = i;
+		while (next[r] != r)
+			r = next[r];
+		while (next[i] != r)
 		{
-			swap(it->second.First, it->second.Second);
-			it->second.ForwardOrder ^= it->second.EqualOrientation;
+			int t = next[i];
+			next[i] = r;
+			i = t;
 		}
-		vec.push_back(it->second);
-	}
-	links.clear();
-	for (vector<ContigLink>::iterator it = vec.begin(); it != vec.end(); it++)
+		return r;
+	};
+
+	void Remove(int i)
 	{
-		pair<int, int> pos(it->First, it->Second);
-		links.insert(pair<pair<int,int>,ContigLink>(pos, *it));
-	}
-}
+		next[i] = i + 1;
+		count--;
+		for (i++; i <= n; i += i & -i)
+			tree[i]--;
+	};
+
+private:
+	vector<int> tree, next;
+	int n, count, top;
+};
 
+// Smallest number of links worth bundling in a thread of its own.
+static const int MinimumBundleBlock = 1 << 16;
+
+// Contig pairs are bundled independently, in parallel blocks of about equal numbers of
+// links. The bundles are then added in pair order, so the result does not depend on the
+// number of threads.
 void DataStore::Bundle(bool sortLinks, bool perGroup, bool joinAmbiguous, double distance)
 {
 	if (sortLinks)
 		Sort();
 
-	vector<ContigLink> vec;
-	vector< vector<ContigLink> > space;
-	for (LinkMap::iterator it = links.begin(), start = links.begin(); it != links.end(); it++)
+	LinkTable old;
+	old.Swap(links);
+	vector<int> pairs;
+	pair<int,int> key;
+	for (LinkMap::const_iterator it = old.Begin(); it != old.End(); it++)
+		if (pairs.empty() || it->first != key)
+		{
+			pairs.push_back(it.Index());
+			key = it->first;
+		}
+	int nPairs = pairs.size();
+	pairs.push_back(old.Size());
+
+	int threads = max(1, min(Threads, old.Size() / MinimumBundleBlock));
+	vector<int> blocks(1, 0);
+	for (int t = 1; t < threads; t++)
 	{
-		vec.clear();
-		while (it != links.end() && it->first == start->first)
+		int target = (long long)old.Size() * t / threads;
+		int p = max(blocks.back(), (int)(lower_bound(pairs.begin(), pairs.begin() + nPairs, target) - pairs.begin()));
+		blocks.push_back(p);
+	}
+	blocks.push_back(nPairs);
+	vector< vector<LinkBundle> > bundles(threads);
+	vector<thread> workers;
+	for (int t = 1; t < threads; t++)
+		workers.push_back(thread(&DataStore::bundleRange, &old, &pairs, blocks[t], blocks[t + 1], perGroup, joinAmbiguous, distance, &bundles[t]));
+	bundleRange(&old, &pairs, blocks[0], blocks[1], perGroup, joinAmbiguous, distance, &bundles[0]);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	for (int t = 0; t < threads; t++)
+	{
+		for (vector<LinkBundle>::const_iterator it = bundles[t].begin(); it != bundles[t].end(); it++)
 		{
-			vec.push_back(it->second);
-			it++;
+			int groupId = it->Groups.front();
+			if (it->Groups.size() > 1)
+			{
+				string name;
+				string description = "Group for bundle-links joining several groups.";
+				for (vector<int>::const_iterator id = it->Groups.begin(); id != it->Groups.end(); id++)
+					name = name + "+" + Helpers::ItoStr(*id);
+				groupId = AddGroup(LinkGroup(name, description));
+			}
+			AddLink(groupId, it->Link);
 		}
-		start = it--;
-		space.push_back(vec);
+		vector<LinkBundle>().swap(bundles[t]);
+	}
+	LinkCount = links.Size();
+}
+
+void DataStore::bundleRange(const LinkTable *links, const vector<int> *pairs, int begin, int end, bool perGroup, bool joinAmbiguous, double distance, vector<LinkBundle> *bundles)
+{
+	vector<ContigLink> l;
+	RemainingPositions remaining;
+	for (int p = begin; p < end; p++)
+	{
+		l.clear();
+		for (LinkMap::const_iterator it(links, (*pairs)[p]), last(links, (*pairs)[p + 1]); it != last; it++)
+			l.push_back(it->second);
+		bundleLinks(l, perGroup, joinAmbiguous, distance, remaining, *bundles);
 	}
-	links.clear();
-	for (vector< vector<ContigLink> >::iterator it = space.begin(); it != space.end(); it++)
-		bundleLinks(*it, perGroup, joinAmbiguous, distance);
 }
 
-// remove nested loop
+// Walks the links of the members only, so the cost is linear in their number (and
+// O(k log k) in the number k of members) rather than in k * k or in the whole store.
 void DataStore::Extract(const vector<int> &what, DataStore &store, vector<int> &transBack)
 {
-	vector<int> transContig(ContigCount, -1);
 	vector<int> transGroup(GroupCount, -1);
+	Extract(what, store, transBack, transGroup);
+}
+
+void DataStore::Extract(const vector<int> &what, DataStore &store, vector<int> &transBack, vector<int> &transGroup)
+{
 	int nWhat = what.size();
+	vector< pair<int,int> > members(nWhat);
+	// source groups in the order they were added to store, for resetting transGroup
+	vector<int> touchedGroups;
 	transBack.resize(nWhat, -1);
 	for (int i = 0; i < nWhat; i++)
 	{
 		int id = store.AddContig(contigs[what[i]]);
-		transContig[what[i]] = id;
+		members[i] = make_pair(what[i], id);
 		transBack[id] = what[i];
 	}
+	// sorted by id in this store, for the lookup of the second contig of a link
+	sort(members.begin(), members.end());
 	for (int i = 0; i < nWhat; i++)
-		for (int j = 0; j < nWhat; j++)
+	{
+		LinkRange range = (*this)(what[i]);
+		int first = lower_bound(members.begin(), members.end(), make_pair(what[i], -1))->second;
+		for (LinkMap::const_iterator it = range.first; it != range.second; it++)
 		{
-			LinkRange range = (*this)(what[i], what[j]);
-			for (LinkMap::const_iterator it = range.first; it != range.second; it++)
+			vector< pair<int,int> >::const_iterator second = lower_bound(members.begin(), members.end(), make_pair(it->first.second, -1));
+			if (second == members.end() || second->first != it->first.second)
+				continue;
+			int groupId = it->second.GetGroupID();
+			if (transGroup[groupId] < 0)
 			{
-				int groupId = it->second.GetGroupID();
-				if (transGroup[groupId] < 0)
-					transGroup[groupId] = store.AddGroup(this->GetGroup(groupId));
-				ContigLink link(transContig[what[i]], transContig[what[j]], it->second.Mean, it->second.Std, it->second.EqualOrientation, it->second.ForwardOrder, it->second.Weight);
-				link.Ambiguous = it->second.Ambiguous;
-				store.AddLink(transGroup[groupId], link);
+				transGroup[groupId] = store.AddGroup(this->GetGroup(groupId));
+				touchedGroups.push_back(groupId);
 			}
+			ContigLink link(first, second->second, it->second.Mean, it->second.Std, it->second.EqualOrientation, it->second.ForwardOrder, it->second.Weight, string(), it->second.Provenance);
+			link.Ambiguous = it->second.Ambiguous;
+			store.AddLink(transGroup[groupId], link);
 		}
+	}
+	for (vector<int>::const_iterator it = touchedGroups.begin(); it != touchedGroups.end(); it++)
+		transGroup[*it] = -1;
+}
+
+int DataStore::Filter(LinkFilter &filter)
+{
+	for (int i = 0; i < LinkFilter::ConditionCount; i++)
+		filter.removed[i] = 0;
+	if (filter.IsEmpty())
+		return 0;
+	filter.prepare(links);
+	int count = links.RemoveIf(filter);
+	LinkCount = links.Size();
+	return count;
 }
 
 int DataStore::RemoveAmbiguous()
 {
-	vector<ContigLink> keep;
-	int count = 0;
-	for (LinkMap::iterator it = links.begin(); it != links.end(); it++)
-		if (!it->second.Ambiguous)
-			keep.push_back(it->second);
-		else
-			count++;
-	links.clear();
-	for (vector<ContigLink>::iterator it = keep.begin(); it != keep.end(); it++)
+	LinkFilter filter;
+	return Filter(filter.RemoveAmbiguous());
+}
+
+int DataStore::Erode(double weight)
+{
+	LinkFilter filter;
+	return Filter(filter.RemoveLighter(weight));
+}
+
+int DataStore::IsolateContigs(const vector<int> &ids)
+{
+	LinkFilter filter;
+	return Filter(filter.Isolate(ids));
+}
+
+LinkFilter::LinkFilter() : weight(0), percentile(100), partners(0), hubDegree(0), cappedPairs(0)
+{
+	for (int i = 0; i < ConditionCount; i++)
+		active[i] = false, removed[i] = 0;
+}
+
+LinkFilter &LinkFilter::RemoveAmbiguous()
+{
+	active[AmbiguousLinks] = true;
+	return *this;
+}
+
+LinkFilter &LinkFilter::RemoveLighter(double weight)
+{
+	active[LightLinks] = true;
+	this->weight = weight;
+	return *this;
+}
+
+LinkFilter &LinkFilter::Isolate(const vector<int> &contigs)
+{
+	active[IsolatedContigs] = true;
+	mark(contigs, isolated);
+	return *this;
+}
+
+LinkFilter &LinkFilter::SelectGroups(const vector<int> &groups)
+{
+	active[OtherGroups] = true;
+	mark(groups, this->groups);
+	return *this;
+}
+
+LinkFilter &LinkFilter::IsolateHubs(double percentile)
+{
+	active[HubContigs] = true;
+	this->percentile = percentile;
+	return *this;
+}
+
+LinkFilter &LinkFilter::CapPartners(int partners)
+{
+	active[CappedPartners] = true;
+	this->partners = partners;
+	return *this;
+}
+
+bool LinkFilter::IsEmpty() const
+{
+	for (int i = 0; i < ConditionCount; i++)
+		if (active[i])
+			return false;
+	return true;
+}
+
+int LinkFilter::Removed(Condition condition) const
+{
+	return removed[condition];
+}
+
+const vector<int> &LinkFilter::Hubs() const
+{
+	return hubs;
+}
+
+int LinkFilter::HubDegree() const
+{
+	return hubDegree;
+}
+
+int LinkFilter::CappedPairs() const
+{
+	return cappedPairs;
+}
+
+void LinkFilter::mark(const vector<int> &ids, vector<bool> &bitmap)
+{
+	for (vector<int>::const_iterator id = ids.begin(); id != ids.end(); id++)
 	{
-		pair<int, int> pos(it->First, it->Second);
-		links.insert(pair<pair<int,int>,ContigLink>(pos, *it));
+		if (*id < 0)
+			continue;
+		if (*id >= (int)bitmap.size())
+			bitmap.resize(*id + 1, false);
+		bitmap[*id] = true;
 	}
-	return count;
 }
 
-int DataStore::Erode(double weight)
+int LinkFilter::test(const ContigLinkView &link) const
 {
-	vector<ContigLink> keep;
-	int count = 0;
-	for (LinkMap::iterator it = links.begin(); it != links.end(); it++)
-		if (it->second.Weight - weight > - Helpers::Eps)
-			keep.push_back(it->second);
-		else
-			count++;
-	links.clear();
-	for (vector<ContigLink>::iterator it = keep.begin(); it != keep.end(); it++)
+	if (active[AmbiguousLinks] && link.Ambiguous)
+		return AmbiguousLinks;
+	if (active[LightLinks] && !(link.Weight - weight > - Helpers::Eps))
+		return LightLinks;
+	if (active[IsolatedContigs] && ((link.First < (int)isolated.size() && isolated[link.First]) || (link.Second < (int)isolated.size() && isolated[link.Second])))
+		return IsolatedContigs;
+	if (active[OtherGroups] && (link.GetGroupID() >= (int)groups.size() || !groups[link.GetGroupID()]))
+		return OtherGroups;
+	return ConditionCount;
+}
+
+bool LinkFilter::operator() (int position, const ContigLinkView &link)
+{
+	int condition = test(link);
+	if (condition == ConditionCount)
 	{
-		pair<int, int> pos(it->First, it->Second);
-		links.insert(pair<pair<int,int>,ContigLink>(pos, *it));
+		if (active[HubContigs] && ((link.First < (int)hub.size() && hub[link.First]) || (link.Second < (int)hub.size() && hub[link.Second])))
+			condition = HubContigs;
+		else if (active[CappedPartners] && position < (int)capped.size() && capped[position])
+			condition = CappedPartners;
+		else
+			return false;
 	}
-	return count;
+	removed[condition]++;
+	return true;
 }
 
-int DataStore::IsolateContigs(const vector<int> &ids)
+// Two linked contigs, the smaller id first, and the total weight of their links.
+typedef pair<pair<int,int>, double> Partnership;
+
+static bool partnersBefore(const Partnership &a, const pair<int,int> &contigs)
 {
-    vector<ContigLink> keep;
-    int count = 0;
-    for (LinkMap::const_iterator it = links.begin(); it != links.end(); it++)
-    {
-        bool shouldKeep = true;
-        for (vector<int>::const_iterator id = ids.begin(); id != ids.end(); id++)
-            if (it->first.first == *id || it->first.second == *id)
-            {
-                shouldKeep = false;
-                break;
-            }
-        if (shouldKeep)
-            keep.push_back(it->second);
-        else
-            count++;
-    }
-    links.clear();
-    for (vector<ContigLink>::iterator it = keep.begin(); it != keep.end(); it++)
-    {
-        pair<int, int> pos(it->First, it->Second);
-        links.insert(pair<pair<int,int>,ContigLink>(pos, *it));
-    }
-    return count;
+	return a.first < contigs;
+}
+
+// Orders the partnerships of a contig, given by index, heaviest first.
+class HeavierPartnership
+{
+public:
+	HeavierPartnership(const vector<Partnership> &pairs) : pairs(pairs) {};
+	bool operator() (int a, int b) const { return pairs[a].second > pairs[b].second || (pairs[a].second == pairs[b].second && a < b); };
+
+private:
+	const vector<Partnership> &pairs;
+};
+
+// Links in either direction between two contigs are one partnership, weighed by their
+// total weight. Hubs are found first, so the cap ranks only the partners left to others.
+void LinkFilter::prepare(const LinkTable &links)
+{
+	hubs.clear();
+	hub.clear();
+	capped.clear();
+	hubDegree = cappedPairs = 0;
+	if (!active[HubContigs] && !active[CappedPartners])
+		return;
+	vector<Partnership> pairs;
+	int nContigs = 0;
+	for (LinkTable::const_iterator it = links.Begin(); it != links.End(); it++)
+	{
+		const ContigLinkView &link = it->second;
+		if (link.First == link.Second || test(link) != ConditionCount)
+			continue;
+		pairs.push_back(Partnership(make_pair(min(link.First, link.Second), max(link.First, link.Second)), link.Weight));
+		nContigs = max(nContigs, max(link.First, link.Second) + 1);
+	}
+	sort(pairs.begin(), pairs.end());
+	int n = 0;
+	for (int i = 0; i < (int)pairs.size(); i++)
+	{
+		if (n > 0 && pairs[n - 1].first == pairs[i].first)
+			pairs[n - 1].second += pairs[i].second;
+		else
+			pairs[n++] = pairs[i];
+	}
+	pairs.resize(n);
+	vector<int> degree(nContigs + 1, 0);
+	for (int i = 0; i < n; i++)
+		degree[pairs[i].first.first]++, degree[pairs[i].first.second]++;
+	if (active[HubContigs])
+	{
+		vector<int> degrees;
+		for (int i = 0; i < nContigs; i++)
+			if (degree[i] > 0)
+				degrees.push_back(degree[i]);
+		if (!degrees.empty())
+		{
+			sort(degrees.begin(), degrees.end());
+			int rank = (int)ceil(percentile / 100.0 * degrees.size()) - 1;
+			hubDegree = degrees[max(0, min(rank, (int)degrees.size() - 1))];
+			for (int i = 0; i < nContigs; i++)
+				if (degree[i] > hubDegree)
+					hubs.push_back(i);
+			mark(hubs, hub);
+		}
+		int kept = 0;
+		for (int i = 0; i < n; i++)
+			if (!(pairs[i].first.first < (int)hub.size() && hub[pairs[i].first.first]) && !(pairs[i].first.second < (int)hub.size() && hub[pairs[i].first.second]))
+				pairs[kept++] = pairs[i];
+		n = kept;
+		pairs.resize(n);
+	}
+	if (!active[CappedPartners])
+		return;
+	// partnerships of every contig in a row of a CSR index
+	vector<int> rows(nContigs + 1, 0);
+	for (int i = 0; i < n; i++)
+		rows[pairs[i].first.first + 1]++, rows[pairs[i].first.second + 1]++;
+	for (int i = 0; i < nContigs; i++)
+		rows[i + 1] += rows[i];
+	vector<int> row(rows[nContigs]), next(rows.begin(), rows.end() - 1);
+	for (int i = 0; i < n; i++)
+		row[next[pairs[i].first.first]++] = row[next[pairs[i].first.second]++] = i;
+	vector<bool> dropped(n, false);
+	for (int c = 0; c < nContigs; c++)
+	{
+		vector<int>::iterator begin = row.begin() + rows[c], end = row.begin() + rows[c + 1];
+		if (end - begin <= partners)
+			continue;
+		sort(begin, end, HeavierPartnership(pairs));
+		for (vector<int>::iterator it = begin + partners; it != end; it++)
+			dropped[*it] = true;
+	}
+	capped.assign(links.Size(), false);
+	for (LinkTable::const_iterator it = links.Begin(); it != links.End(); it++)
+	{
+		const ContigLinkView &link = it->second;
+		if (link.First == link.Second)
+			continue;
+		pair<int,int> contigs(min(link.First, link.Second), max(link.First, link.Second));
+		vector<Partnership>::const_iterator p = lower_bound(pairs.begin(), pairs.end(), contigs, partnersBefore);
+		if (p != pairs.end() && p->first == contigs && dropped[p - pairs.begin()])
+			capped[it.Index()] = true;
+	}
+	for (int i = 0; i < n; i++)
+		if (dropped[i])
+			cappedPairs++;
 }
 
 /*void DataStore::temp()
@@ -314,7 +1092,13 @@ int DataStore::IsolateContigs(const vector<int> &ids)
 		links.insert(pair<pair<int,int>, ContigLink>(pair<int,int>(it->First, it->Second), *it));
 }*/
 
-void DataStore::bundleLinks(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, double distance)
+bool DataStore::sameRun(const ContigLink &a, const ContigLink &b, bool perGroup, bool joinAmbiguous)
+{
+	return (!perGroup || a.GetGroupID() == b.GetGroupID()) && a.EqualOrientation == b.EqualOrientation && a.ForwardOrder == b.ForwardOrder && (joinAmbiguous || a.Ambiguous == b.Ambiguous);
+}
+
+// Sorts the links of one contig pair into runs that may be bundled together, ordered by mean.
+void DataStore::bundleLinks(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, double distance, RemainingPositions &remaining, vector<LinkBundle> &bundles)
 {
 	if (perGroup && joinAmbiguous)
 		sort(l.begin(), l.end(), linkComparerGroup);
@@ -324,55 +1108,80 @@ void DataStore::bundleLinks(vector<ContigLink> &l, bool perGroup, bool joinAmbig
 		sort(l.begin(), l.end(), linkComparer);
 	else
 		sort(l.begin(), l.end(), linkComparerAmbiguous);
-	int s = 0;
-	vector<ContigLink> sel;
-	while (selectGroup(l, perGroup, joinAmbiguous, s, sel))
-		while (sel.size() > 0)
-			performBundle(sel, distance);
-}
-
-void DataStore::performBundle(vector<ContigLink> &l, double distance)
-{
-	vector<ContigLink> r;
-	set<int> groupIds;
-	int n = l.size(), m = (n % 2 == 1 ? n / 2 : n / 2 - 1);
-	if (n == 0) return;
-	double p = 0, q = 0, w = 0;
-	bool ambiguous = false;
-	string comment;
-	for (int i = 0; i < n; i++)
-		if (abs(l[i].Mean - l[m].Mean) < distance * l[m].Std)
+	int n = l.size();
+	for (int begin = 0, end = 0; begin < n; begin = end)
+	{
+		for (end = begin + 1; end < n && sameRun(l[begin], l[end], perGroup, joinAmbiguous); end++)
+			;
+		sweepBundles(l, begin, end, distance, remaining, bundles);
+	}
+}
+
+// Repeatedly bundles the remaining link with the median mean and all remaining links within
+// distance standard deviations of it. As the run is sorted by mean those links form one
+// range around the median, found by binary search.
+void DataStore::sweepBundles(const vector<ContigLink> &l, int begin, int end, double distance, RemainingPositions &remaining, vector<LinkBundle> &bundles)
+{
+	const ContigLink *run = &l[begin];
+	int n = end - begin;
+	remaining.Reset(n);
+	while (remaining.Count() > 0)
+	{
+		int count = remaining.Count();
+		int m = remaining.Find(count % 2 == 1 ? count / 2 : count / 2 - 1);
+		const ContigLink &median = run[m];
+		double limit = distance * median.Std;
+		int first = m, last = m + 1;
+		// with a zero std the median is not within distance of even itself, so it bundles only itself
+		if (limit > 0)
+		{
+			for (int lo = 0, hi = m; lo < hi; )
+			{
+				int mid = (lo + hi) / 2;
+				if (abs(run[mid].Mean - median.Mean) < limit)
+					hi = mid;
+				else
+					lo = mid + 1;
+				first = lo;
+			}
+			for (int lo = m + 1, hi = n; lo < hi; )
+			{
+				int mid = (lo + hi) / 2;
+				if (abs(run[mid].Mean - median.Mean) < limit)
+					lo = mid + 1;
+				else
+					hi = mid;
+				last = lo;
+			}
+		}
+		double p = 0, q = 0, w = 0;
+		bool ambiguous = false;
+		string comment;
+		LinkProvenance provenance(0, -1, -1);
+		bundles.push_back(LinkBundle());
+		LinkBundle &bundle = bundles.back();
+		for (int i = remaining.Next(first); i < last; i = remaining.Next(i + 1))
 		{
-			p += l[i].Mean / (l[i].Std * l[i].Std);
-			q += 1 / (l[i].Std * l[i].Std);
-			w += l[i].Weight;
-			ambiguous = ambiguous || l[i].Ambiguous;
-			if (l[i].Comment.length() > 0)
+			p += run[i].Mean / (run[i].Std * run[i].Std);
+			q += 1 / (run[i].Std * run[i].Std);
+			w += run[i].Weight;
+			ambiguous = ambiguous || run[i].Ambiguous;
+			if (run[i].Comment.length() > 0)
 			{
 				if (comment.length() == 0)
-					comment = l[i].Comment;
+					comment = run[i].Comment;
 				else
-					comment += "|" + l[i].Comment;
+					comment += "|" + run[i].Comment;
 			}
-			groupIds.insert(l[i].GetGroupID());
+			provenance.Join(run[i].Provenance);
+			vector<int>::iterator group = lower_bound(bundle.Groups.begin(), bundle.Groups.end(), run[i].GetGroupID());
+			if (group == bundle.Groups.end() || *group != run[i].GetGroupID())
+				bundle.Groups.insert(group, run[i].GetGroupID());
+			remaining.Remove(i);
 		}
-		else r.push_back(l[i]);
-	ContigLink link(l[m].First, l[m].Second, p / q, 1 / sqrt(q), l[m].EqualOrientation, l[m].ForwardOrder, w, comment);
-	link.Ambiguous = ambiguous;
-	int groupId;
-	if (groupIds.size() > 1)
-	{
-		string name;
-		string description = "Group for bundle-links joining several groups.";
-		for (set<int>::iterator it = groupIds.begin(); it != groupIds.end(); it++)
-			name = name + "+" + Helpers::ItoStr(*it);
-		groupId = AddGroup(LinkGroup(name, description));
+		bundle.Link = ContigLink(median.First, median.Second, p / q, 1 / sqrt(q), median.EqualOrientation, median.ForwardOrder, w, comment, provenance);
+		bundle.Link.Ambiguous = ambiguous;
 	}
-	else
-		groupId = *groupIds.begin();
-	AddLink(groupId, link);
-	l.clear();
-	l.insert(l.begin(), r.begin(), r.end());
 }
 
 bool DataStore::linkComparerAmbiguous(const ContigLink &a, const ContigLink &b)
@@ -423,16 +1232,3 @@ bool DataStore::linkComparerAmbiguousGroup(const ContigLink &a, const ContigLink
 	return linkComparerAmbiguous(a, b);
 }
 
-bool DataStore::selectGroup(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, int &s, vector<ContigLink> &selection)
-{
-	int i = s;
-	int n = l.size();
-	if (i >= n)
-		return false;
-	s++;
-	selection.clear();
-	selection.push_back(l[i]);
-	while (s < n && ((!perGroup || l[i].GetGroupID() == l[s].GetGroupID()) && l[i].EqualOrientation == l[s].EqualOrientation && l[i].ForwardOrder == l[s].ForwardOrder && (joinAmbiguous || l[i].Ambiguous == l[s].Ambiguous)))
-		selection.push_back(l[s++]);
-	return true;
-}
@@ -30,34 +30,74 @@
 #define _DATASTORE_H
 
 #include "Sequence.h"
+#include "PackedSequence.h"
+#include "FastAIndex.h"
 #include <vector>
 #include <string>
 #include <map>
 #include <set>
+#include <memory>
+#include <iterator>
+#include <cstddef>
+#include <stdint.h>
 
 using namespace std;
 
+// Contig sequences are kept 2-bit packed; GetFastA unpacks a copy in either orientation.
+// Contigs read in lengths-only mode keep no sequence but an entry of a FastAIndex
+// from which it is fetched when needed.
 class Contig
 {
 public:
-	Contig(const FastASequence &seq = FastASequence()) : Sequence(seq), id(0) {};
+	Contig(const FastASequence &seq = FastASequence()) : Sequence(seq.Nucleotides), Comment(seq.Comment), id(0), length(0), sourceEntry(-1) {};
+	Contig(const shared_ptr<const FastAIndex> &source, int entry);
 
 public:
 	int GetID() const;
+	int Length() const;
+	string Name() const;
+	bool HasSequence() const;
+	bool GetNucleotides(string &nucleotides) const;
+	FastASequence GetFastA(bool reverseComplement = false) const;
 
 public:
-	FastASequence Sequence;
+	PackedSequence Sequence;
+	string Comment;
 
 private:
 	int id;
+	int length;
+	shared_ptr<const FastAIndex> source;
+	int sourceEntry;
 
 	friend class DataStore;
 };
 
+class ContigLinkView;
+
+// The read pairs a link was made from: their number and the range of their ids. Ids are
+// numbered by the tool that made the link (dataLinker: position of the pair in its input);
+// -1 when not recorded. Bundling adds up the counts and widens the range.
+class LinkProvenance
+{
+public:
+	LinkProvenance(int64_t readPair = -1) : Count(1), First(readPair), Last(readPair) {};
+	LinkProvenance(int count, int64_t first, int64_t last) : Count(count), First(first), Last(last) {};
+
+public:
+	bool IsRecorded() const;
+	void Join(const LinkProvenance &other);
+
+public:
+	int Count;
+	int64_t First, Last;
+};
+
 class ContigLink
 {
 public:
-	ContigLink(int first = -1, int second = -1, double mean = 0, double std = 0, bool equalOrientation = false, bool forwardOrder = false, double weight = 0, const string &comment = string());
+	ContigLink(int first = -1, int second = -1, double mean = 0, double std = 0, bool equalOrientation = false, bool forwardOrder = false, double weight = 0, const string &comment = string(), const LinkProvenance &provenance = LinkProvenance());
+	ContigLink(const ContigLinkView &view);
 
 public:
 	bool operator< (const ContigLink &other);
@@ -71,6 +111,7 @@ public:
 	double Weight;
 	bool Ambiguous;
 	string Comment;
+	LinkProvenance Provenance;
 
 private:
 	int groupId;
@@ -78,6 +119,236 @@ private:
 	friend class DataStore;
 };
 
+// A link as read from a LinkTable: the fields of ContigLink, but the comment is
+// referred to instead of copied. Converts to a ContigLink where one is needed.
+class ContigLinkView
+{
+public:
+	int GetGroupID() const { return groupId; };
+
+public:
+	int First, Second;
+	double Mean, Std;
+	bool EqualOrientation;
+	bool ForwardOrder;
+	double Weight;
+	bool Ambiguous;
+	const char *Comment;
+	LinkProvenance Provenance;
+
+private:
+	int groupId;
+
+	friend class LinkTable;
+	friend class LinkSink;
+};
+
+// Links stored column by column and sorted by (first, second) contig, links between the
+// same contigs in the order they were added. A row index over the first contig (CSR)
+// finds the links between two contigs. Links added out of order are sorted in on the
+// next read, so a table that is being filled must not be read from several threads.
+class LinkTable
+{
+public:
+	class Entry
+	{
+	public:
+		pair<int,int> first;
+		ContigLinkView second;
+	};
+
+	// Walks the table in order; dereferencing yields an Entry with the same members as a
+	// multimap<pair<int,int>,ContigLink> element.
+	class const_iterator
+	{
+	public:
+		typedef bidirectional_iterator_tag iterator_category;
+		typedef Entry value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const Entry *pointer;
+		typedef const Entry &reference;
+
+	public:
+		const_iterator(const LinkTable *table = NULL, int index = 0) : table(table), index(index), loaded(-1) {};
+
+	public:
+		const Entry &operator* () const { load(); return entry; };
+		const Entry *operator-> () const { load(); return &entry; };
+		const_iterator &operator++ () { index++; return *this; };
+		const_iterator operator++ (int) { const_iterator old(*this); index++; return old; };
+		const_iterator &operator-- () { index--; return *this; };
+		const_iterator operator-- (int) { const_iterator old(*this); index--; return old; };
+		bool operator== (const const_iterator &other) const { return index == other.index; };
+		bool operator!= (const const_iterator &other) const { return index != other.index; };
+		// Position of the link in the table.
+		int Index() const { return index; };
+
+	private:
+		void load() const;
+
+	private:
+		const LinkTable *table;
+		int index;
+		mutable int loaded;
+		mutable Entry entry;
+	};
+	typedef const_iterator iterator;
+
+	enum Flag
+	{
+		EqualOrientation = 1,
+		ForwardOrder = 2,
+		Ambiguous = 4
+	};
+
+public:
+	LinkTable();
+
+public:
+	int Size() const;
+	void Clear();
+	void Swap(LinkTable &other);
+	void Reserve(int n);
+	void Add(int groupId, const ContigLink &link);
+	void Add(int groupId, const ContigLinkView &link);
+	// Appends the links of other, shifting their group ids by groupOffset and their
+	// recorded read pair ids by readPairOffset.
+	void Append(const LinkTable &other, int groupOffset = 0, int64_t readPairOffset = 0);
+	// One past the highest recorded read pair id, 0 if none is recorded.
+	int64_t ReadPairEnd() const;
+	const_iterator Begin() const;
+	const_iterator End() const;
+	// Links from contig i to contig j.
+	pair<const_iterator, const_iterator> Range(int i, int j) const;
+	// Links from contig i to any contig.
+	pair<const_iterator, const_iterator> Range(int i) const;
+	// Removes the links marked in removed (indexed by position) and returns their number.
+	int Remove(const vector<bool> &removed);
+	// Removes, in one pass, the links for which predicate(position, link) holds.
+	template<class Predicate> int RemoveIf(Predicate &predicate);
+	// Orders every link so that its first contig has the smaller id.
+	void Normalize();
+	// Sorts the table and builds its row index now rather than on the next read.
+	void BuildIndex() const;
+	size_t MemoryUsage() const;
+
+private:
+	void add(int first, int second, double mean, double std, int flags, double weight, int groupId, const LinkProvenance &provenance, const char *comment, size_t commentLength);
+	void view(int i, ContigLinkView &link) const;
+	void move(int from, int to, string &keptComments);
+	void resize(int n);
+	void sort() const;
+	void buildRows() const;
+	template<class T> static void permute(vector<T> &column, const vector<int> &order);
+
+private:
+	// Columns are mutable as out of order additions are sorted in by the first read.
+	mutable vector<int> first, second, group;
+	mutable vector<double> mean, std, weight;
+	mutable vector<uint8_t> flags;
+	mutable vector<int64_t> comment;
+	mutable vector<int> pairs;
+	mutable vector<int64_t> firstPair, lastPair;
+	mutable vector<int> rows;
+	mutable bool sorted, indexed;
+	// Zero-terminated comments; offset 0 is the empty comment.
+	string comments;
+
+	friend class const_iterator;
+};
+
+template<class Predicate> int LinkTable::RemoveIf(Predicate &predicate)
+{
+	sort();
+	int n = Size(), kept = 0;
+	string keptComments(1, '\0');
+	ContigLinkView link;
+	for (int i = 0; i < n; i++)
+	{
+		view(i, link);
+		if (!predicate(i, link))
+			move(i, kept++, keptComments);
+	}
+	resize(kept);
+	comments.swap(keptComments);
+	indexed = false;
+	return n - kept;
+}
+
+// Conditions under which links are removed from a store. DataStore::Filter applies all
+// of them in a single pass and counts every removed link for the first condition in the
+// order below that applies to it.
+class LinkFilter
+{
+public:
+	enum Condition
+	{
+		AmbiguousLinks,
+		LightLinks,
+		IsolatedContigs,
+		OtherGroups,
+		HubContigs,
+		CappedPartners,
+		ConditionCount
+	};
+
+public:
+	LinkFilter();
+
+public:
+	// Removes links marked ambiguous.
+	LinkFilter &RemoveAmbiguous();
+	// Removes links lighter than weight, as DataStore::Erode.
+	LinkFilter &RemoveLighter(double weight);
+	// Removes all links of the given contigs.
+	LinkFilter &Isolate(const vector<int> &contigs);
+	// Removes links of all groups but the given ones.
+	LinkFilter &SelectGroups(const vector<int> &groups);
+	// Removes all links of contigs linked to more partners than contigs at the given
+	// percentile of those with any partner. Repeats that were not detected as such tend
+	// to be such hubs.
+	LinkFilter &IsolateHubs(double percentile);
+	// Keeps the links between two contigs only if each is among the given number of
+	// partners of the other with the largest total link weight.
+	LinkFilter &CapPartners(int partners);
+	bool IsEmpty() const;
+	// Links removed for a condition by the last DataStore::Filter.
+	int Removed(Condition condition) const;
+	// Contigs isolated as hubs by the last DataStore::Filter, and the number of partners
+	// above which a contig was a hub.
+	const vector<int> &Hubs() const;
+	int HubDegree() const;
+	// Contig pairs whose links were removed by the partner cap in the last DataStore::Filter.
+	int CappedPairs() const;
+	bool operator() (int position, const ContigLinkView &link);
+
+private:
+	static void mark(const vector<int> &ids, vector<bool> &bitmap);
+	// The first of the conditions that need no other links applying to a link, or ConditionCount.
+	int test(const ContigLinkView &link) const;
+	// Partners are counted and weighed over the links the other conditions keep.
+	void prepare(const LinkTable &links);
+
+private:
+	bool active[ConditionCount];
+	int removed[ConditionCount];
+	double weight;
+	vector<bool> isolated;
+	vector<bool> groups;
+	double percentile;
+	int partners;
+	vector<int> hubs;
+	vector<bool> hub;
+	int hubDegree;
+	// Links removed by the partner cap, by position.
+	vector<bool> capped;
+	int cappedPairs;
+
+	friend class DataStore;
+};
+
+class RemainingPositions;
+
 class LinkGroup
 {
 public:
@@ -100,37 +371,74 @@ class DataStore
 {
 public:
 	DataStore() : ContigCount(0), LinkCount(0), GroupCount(0) {};
-	typedef multimap<pair<int,int>,ContigLink> LinkMap;
+	typedef LinkTable LinkMap;
 	typedef pair<LinkMap::const_iterator, LinkMap::const_iterator> LinkRange;
 
+public:
+	// A read-only store that solvers share instead of keeping copies. Its links are
+	// indexed up front, so reading it never modifies it. The second form takes over the
+	// contents of store without copying them and leaves it empty.
+	static shared_ptr<const DataStore> Snapshot(const DataStore &store);
+	static shared_ptr<const DataStore> Snapshot(DataStore &&store);
+
+public:
+	// Number of worker threads used to bundle links, load text stores and merge shards;
+	// all cores unless capped with the -threads option of a tool.
+	static int Threads;
+
 public:
 	const Contig &operator[] (int i) const;
 	const LinkRange operator() (int i, int j) const;
+	// Links from contig i to any other contig.
+	const LinkRange operator() (int i) const;
 	LinkMap::const_iterator Begin() const;
 	LinkMap::const_iterator End() const;
-	LinkMap::iterator Begin();
-	LinkMap::iterator End();
 	const LinkGroup &GetGroup(int id) const;
         vector<FastASequence> GetContigs() const;
 	int AddContig(const Contig &contig);
 	int AddGroup(const LinkGroup &group);
-	LinkMap::const_iterator AddLink(int groupId, const ContigLink &link);
-	bool ReadContigs(const string &fileName);
+	void AddLink(int groupId, const ContigLink &link);
+	// Adds links in bulk; links given in store order are appended in constant time each.
+	void AddLinks(const LinkTable &links);
+	// Adds the groups and links of other, a store over the same contigs, with its group
+	// ids shifted past those of this store and its recorded read pair ids past
+	// ReadPairEnd(), so that provenance from separate runs never overlaps. Returns false,
+	// adding nothing, if the contigs of the two stores differ in number, comment or length.
+	bool Merge(const DataStore &other);
+	// One past the highest read pair id recorded in the links, 0 if none is recorded.
+	int64_t ReadPairEnd() const;
+	// In lengths-only mode only names and lengths are kept and sequences are read from the file on demand.
+	bool ReadContigs(const string &fileName, bool lengthsOnly = false);
 	void Sort();
 	void Bundle(bool sortLinks, bool perGroup, bool joinAmbiguous, double distance = 3);
+	// Copies contigs what and the links among them into store; transBack maps the new ids back.
 	void Extract(const vector<int> &what, DataStore &store, vector<int> &transBack);
+	// As above, with transGroup a caller-held map of GroupCount entries, all -1, that is left
+	// so on return. Extracting many components then costs no per-component group table.
+	void Extract(const vector<int> &what, DataStore &store, vector<int> &transBack, vector<int> &transGroup);
+	// Removes links matching the filter in one pass and returns their number.
+	int Filter(LinkFilter &filter);
 	int RemoveAmbiguous();
 	int Erode(double weight);
         int IsolateContigs(const vector<int> &ids);
 
 private:
-	void bundleLinks(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, double distance);
-	void performBundle(vector<ContigLink> &l, double distance);
+	// A bundled link and the (sorted, distinct) groups of the links it joins.
+	class LinkBundle
+	{
+	public:
+		ContigLink Link;
+		vector<int> Groups;
+	};
+
+	static void bundleRange(const LinkTable *links, const vector<int> *pairs, int begin, int end, bool perGroup, bool joinAmbiguous, double distance, vector<LinkBundle> *bundles);
+	static void bundleLinks(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, double distance, RemainingPositions &remaining, vector<LinkBundle> &bundles);
+	static void sweepBundles(const vector<ContigLink> &l, int begin, int end, double distance, RemainingPositions &remaining, vector<LinkBundle> &bundles);
 	static bool linkComparer(const ContigLink &a, const ContigLink &b);
 	static bool linkComparerAmbiguous(const ContigLink &a, const ContigLink &b);
 	static bool linkComparerGroup(const ContigLink &a, const ContigLink &b);
 	static bool linkComparerAmbiguousGroup(const ContigLink &a, const ContigLink &b);
-	static bool selectGroup(vector<ContigLink> &l, bool perGroup, bool joinAmbiguous, int &s, vector<ContigLink> &selection);
+	static bool sameRun(const ContigLink &a, const ContigLink &b, bool perGroup, bool joinAmbiguous);
 
 public:
 	int ContigCount;
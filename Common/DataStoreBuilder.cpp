@@ -0,0 +1,188 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "DataStoreBuilder.h"
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+using namespace std;
+
+// Contigs are merged in blocks of at least this many links per thread.
+static const int MinimumMergeBlock = 1 << 16;
+
+int DataStoreBuilder::Shard::AddGroup(const LinkGroup &group)
+{
+	groups.push_back(group);
+	return groups.size() - 1;
+}
+
+void DataStoreBuilder::Shard::AddLink(int groupId, const ContigLink &link)
+{
+	if (groupId < 0 || groupId >= (int)groups.size())
+		throw exception();
+	links.Add(groupId, link);
+}
+
+int DataStoreBuilder::Shard::GroupCount() const
+{
+	return groups.size();
+}
+
+int DataStoreBuilder::Shard::LinkCount() const
+{
+	return links.Size();
+}
+
+DataStoreBuilder::DataStoreBuilder(int shards)
+	: shards(max(1, shards))
+{
+}
+
+DataStoreBuilder::Shard &DataStoreBuilder::operator[] (int i)
+{
+	return shards[i];
+}
+
+int DataStoreBuilder::ShardCount() const
+{
+	return shards.size();
+}
+
+void DataStoreBuilder::Merge(DataStore &store)
+{
+	vector<LinkTable> parts;
+	mergeShards(store, parts);
+	for (size_t t = 0; t < parts.size(); t++)
+	{
+		store.AddLinks(parts[t]);
+		parts[t].Clear();
+	}
+}
+
+// The merged parts are in store order, so the sink takes them as they come.
+bool DataStoreBuilder::Merge(DataStore &store, LinkSink &links)
+{
+	vector<LinkTable> parts;
+	mergeShards(store, parts);
+	bool success = true;
+	for (size_t t = 0; t < parts.size(); t++)
+	{
+		for (LinkTable::const_iterator it = parts[t].Begin(); success && it != parts[t].End(); it++)
+			success = links.Add(it->second.GetGroupID(), ContigLink(it->second));
+		parts[t].Clear();
+	}
+	return success;
+}
+
+// Adds the groups of all shards to store and merges their links into parts, which
+// together hold them in store order. Empties the shards.
+void DataStoreBuilder::mergeShards(DataStore &store, vector<LinkTable> &parts)
+{
+	int nShards = shards.size();
+	vector<int> groupBase(nShards);
+	for (int s = 0; s < nShards; s++)
+	{
+		groupBase[s] = store.GroupCount;
+		for (vector<LinkGroup>::const_iterator it = shards[s].groups.begin(); it != shards[s].groups.end(); it++)
+			store.AddGroup(*it);
+	}
+
+	vector<thread> workers;
+	for (int s = 1; s < nShards; s++)
+		workers.push_back(thread(&DataStoreBuilder::sortShard, &shards[s].links));
+	sortShard(&shards[0].links);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	workers.clear();
+
+	// blocks of contigs with about the same number of links, by first contig
+	int nContigs = 0, nLinks = 0;
+	for (int s = 0; s < nShards; s++)
+		if (shards[s].links.Size() > 0)
+		{
+			nContigs = max(nContigs, (--shards[s].links.End())->first.first + 1);
+			nLinks += shards[s].links.Size();
+		}
+	int threads = max(1, min(DataStore::Threads, nLinks / MinimumMergeBlock));
+	vector<int> blocks(1, 0);
+	long long merged = 0;
+	for (int c = 0; c < nContigs && (int)blocks.size() < threads; c++)
+	{
+		for (int s = 0; s < nShards; s++)
+		{
+			DataStore::LinkRange range = shards[s].links.Range(c);
+			merged += range.second.Index() - range.first.Index();
+		}
+		if (merged >= (long long)nLinks * (int)blocks.size() / threads)
+			blocks.push_back(c + 1);
+	}
+	while ((int)blocks.size() <= threads)
+		blocks.push_back(nContigs);
+	parts.resize(threads);
+	for (int t = 1; t < threads; t++)
+		workers.push_back(thread(&DataStoreBuilder::mergeRange, &shards, &groupBase, blocks[t], blocks[t + 1], &parts[t]));
+	mergeRange(&shards, &groupBase, blocks[0], blocks[1], &parts[0]);
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	for (int s = 0; s < nShards; s++)
+	{
+		shards[s].links.Clear();
+		vector<LinkGroup>().swap(shards[s].groups);
+	}
+}
+
+void DataStoreBuilder::sortShard(LinkTable *links)
+{
+	links->BuildIndex();
+}
+
+// Links from the same contigs are taken shard by shard, so they keep the order in which
+// the shards would have added them.
+void DataStoreBuilder::mergeRange(const vector<Shard> *shards, const vector<int> *groupBase, int begin, int end, LinkTable *part)
+{
+	int nShards = shards->size();
+	vector<DataStore::LinkRange> ranges(nShards);
+	for (int c = begin; c < end; c++)
+	{
+		for (int s = 0; s < nShards; s++)
+			ranges[s] = (*shards)[s].links.Range(c);
+		while (true)
+		{
+			int next = -1;
+			for (int s = 0; s < nShards; s++)
+				if (ranges[s].first != ranges[s].second && (next < 0 || ranges[s].first->first.second < ranges[next].first->first.second))
+					next = s;
+			if (next < 0)
+				break;
+			const ContigLinkView &link = ranges[next].first->second;
+			part->Add((*groupBase)[next] + link.GetGroupID(), link);
+			ranges[next].first++;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#ifndef _DATASTOREBUILDER_H
+#define _DATASTOREBUILDER_H
+
+#include <vector>
+#include "DataStore.h"
+#include "LinkSink.h"
+
+using namespace std;
+
+// Builds the groups and links of a DataStore from several threads without locks. Every
+// thread adds to a shard of its own, whose group ids are local to it. Merge sorts the
+// shards and merges them in parallel, remapping the group ids; the store (or the store
+// and its link sink) ends up as if the shards had been added one after another.
+class DataStoreBuilder
+{
+public:
+	class Shard
+	{
+	public:
+		// Returns the id of the group within the shard.
+		int AddGroup(const LinkGroup &group);
+		void AddLink(int groupId, const ContigLink &link);
+		int GroupCount() const;
+		int LinkCount() const;
+
+	private:
+		vector<LinkGroup> groups;
+		LinkTable links;
+
+		friend class DataStoreBuilder;
+	};
+
+public:
+	DataStoreBuilder(int shards);
+
+public:
+	Shard &operator[] (int i);
+	int ShardCount() const;
+	// Adds the groups and links of all shards to store and empties the shards.
+	void Merge(DataStore &store);
+	// As above, but the links go to links, after those already in it.
+	bool Merge(DataStore &store, LinkSink &links);
+
+private:
+	void mergeShards(DataStore &store, vector<LinkTable> &parts);
+	static void sortShard(LinkTable *links);
+	static void mergeRange(const vector<Shard> *shards, const vector<int> *groupBase, int begin, int end, LinkTable *part);
+
+private:
+	vector<Shard> shards;
+};
+#endif
@@ -28,73 +28,300 @@
 
 #include "DataStoreReader.h"
 #include "Helpers.h"
-#include <sstream>
-
-#include <iostream>
+#include "BinaryDataStore.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+// Smallest part of the link section worth parsing in a thread of its own.
+static const long long MinimumChunkSize = 1 << 20;
+
 DataStoreReader::~DataStoreReader()
 {
-	if (in.is_open())
-		in.close();
+	Close();
 }
 
+// Regular files are mapped, anything else is read into memory, so that the text format
+// can be tokenised in place.
 bool DataStoreReader::Open(const string &fileName)
 {
-	if (in.is_open())
+	if (opened)
+		return false;
+	struct stat s;
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
 		return false;
-	in.open(fileName.c_str(), ios::in);
-	return in.is_open();
+	if (fstat(fd, &s) == 0 && S_ISREG(s.st_mode))
+	{
+		size = s.st_size;
+		if (size > 0)
+		{
+			void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map == MAP_FAILED)
+			{
+				close(fd);
+				return false;
+			}
+			madvise(map, size, MADV_SEQUENTIAL);
+			data = (const char *)map;
+		}
+		mapped = true;
+	}
+	else
+	{
+		char chunk[1 << 16];
+		ssize_t n;
+		while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+			buffer.insert(buffer.end(), chunk, chunk + n);
+		data = (buffer.empty() ? NULL : &buffer[0]);
+		size = buffer.size();
+	}
+	close(fd);
+	this->fileName = fileName;
+	opened = true;
+	pos = 0;
+	return true;
 }
 
 bool DataStoreReader::Close()
 {
-	in.close();
+	if (!opened)
+		return false;
+	if (mapped && data != NULL)
+		munmap((void *)data, size);
+	vector<char>().swap(buffer);
+	data = NULL;
+	size = pos = 0;
+	mapped = opened = false;
 	return true;
 }
 
-bool DataStoreReader::Read(DataStore &store)
+bool DataStoreReader::Read(DataStore &store, bool lengthsOnly)
 {
 	int nContigs, nGroups, nLinks;
-	if (!in.is_open())
+	if (!opened)
 		return false;
+	if (BinaryDataStore::IsBinary(data, size))
+		return readBinary(store, lengthsOnly);
 	if (!readHeader(nContigs, nGroups, nLinks))
 		return false;
-	if (!readContigs(nContigs, store))
+	if (!readContigs(nContigs, store, lengthsOnly))
 		return false;
 	if (!readGroups(nGroups, store))
 		return false;
-	if (!readLinks(nLinks, store))
+	if (!readLinks(nLinks, nGroups, store))
+		return false;
+	return true;
+}
+
+// Binary stores are mapped and copied into the store table by table. In lengths-only
+// mode contigs refer to their sequences in the mapped file.
+bool DataStoreReader::readBinary(DataStore &store, bool lengthsOnly)
+{
+	BinaryDataStore source;
+	if (!mapped || !source.Open(fileName))
+		return false;
+	int nContigs = source.ContigCount(), nGroups = source.GroupCount(), nLinks = source.LinkCount();
+	if (nContigs <= 0 || nGroups <= 0)
+		return false;
+	shared_ptr<FastAIndex> index;
+	if (lengthsOnly)
+	{
+		index.reset(new FastAIndex());
+		if (!index->Attach(fileName))
+			return false;
+	}
+	const int32_t *lengths = source.GetContigLengths();
+	for (int i = 0; i < nContigs; i++)
+	{
+		Contig contig;
+		if (index)
+			contig = Contig(index, index->Add(source.GetContigComment(i), lengths[i], source.GetContigSequenceOffset(i), lengths[i]));
+		else
+			contig = Contig(FastASequence(string(source.GetContigSequence(i), lengths[i]), source.GetContigComment(i)));
+		if (store.AddContig(contig) != i)
+			return false;
+	}
+	for (int i = 0; i < nGroups; i++)
+		if (store.AddGroup(LinkGroup(source.GetGroupName(i), source.GetGroupDescription(i))) != i)
+			return false;
+	const int32_t *first = source.GetLinkFirst(), *second = source.GetLinkSecond(), *group = source.GetLinkGroup();
+	const double *mean = source.GetLinkMean(), *std = source.GetLinkStd(), *weight = source.GetLinkWeight();
+	const uint8_t *flags = source.GetLinkFlags();
+	const int32_t *readPairs = source.GetLinkReadPairs();
+	const int64_t *firstReadPair = source.GetLinkFirstReadPair(), *lastReadPair = source.GetLinkLastReadPair();
+	for (int i = 0; i < nLinks; i++)
+	{
+		if (group[i] < 0 || group[i] >= nGroups)
+			return false;
+		LinkProvenance provenance(readPairs[i], firstReadPair[i], lastReadPair[i]);
+		ContigLink link(first[i], second[i], mean[i], std[i], (flags[i] & BinaryDataStore::EqualOrientation) != 0, (flags[i] & BinaryDataStore::ForwardOrder) != 0, weight[i], source.GetLinkComment(i), provenance);
+		link.Ambiguous = (flags[i] & BinaryDataStore::Ambiguous) != 0;
+		store.AddLink(group[i], link);
+	}
+	return true;
+}
+
+// Returns the next line without its line end. Fails at the end of the input.
+bool DataStoreReader::nextLine(const char *&line, const char *&lineEnd)
+{
+	if (pos >= size)
 		return false;
+	line = data + pos;
+	lineEnd = (const char *)memchr(line, '\n', size - pos);
+	if (lineEnd == NULL)
+		lineEnd = data + size;
+	pos = lineEnd - data + 1;
 	return true;
 }
 
+// Splits a line at tabs without copying. Missing fields are left empty.
+static void splitFields(const char *p, const char *end, const char **fields, int *lengths, int n)
+{
+	for (int i = 0; i < n; i++)
+	{
+		const char *e = p;
+		while (e < end && *e != '\t')
+			e++;
+		fields[i] = p;
+		lengths[i] = e - p;
+		p = (e < end ? e + 1 : end);
+	}
+}
+
+static bool parseLong(const char *p, int length, long long &value)
+{
+	const char *end = p + length;
+	bool negative = (p < end && *p == '-');
+	if (p < end && (*p == '-' || *p == '+'))
+		p++;
+	if (p == end || end - p > 18)
+		return false;
+	long long result = 0;
+	for (; p < end; p++)
+	{
+		if (*p < '0' || *p > '9')
+			return false;
+		result = result * 10 + (*p - '0');
+	}
+	value = (negative ? -result : result);
+	return true;
+}
+
+static bool parseInt(const char *p, int length, int &value)
+{
+	long long result;
+	if (!parseLong(p, length, result) || result != (int)result)
+		return false;
+	value = (int)result;
+	return true;
+}
+
+// Plain decimals with at most 15 significant digits are exactly representable before the
+// final division by a power of ten, which makes the result correctly rounded (the same as
+// strtod). Anything else goes through strtod.
+static bool parseDouble(const char *p, int length, double &value)
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char *s = p, *end = p + length;
+	bool negative = (s < end && *s == '-');
+	if (s < end && (*s == '-' || *s == '+'))
+		s++;
+	unsigned long long mantissa = 0;
+	int digits = 0, scale = 0;
+	bool point = false, any = false;
+	for (; s < end; s++)
+	{
+		if (*s >= '0' && *s <= '9')
+		{
+			any = true;
+			if (mantissa == 0 && *s == '0')
+			{
+				if (point)
+					scale++;
+				continue;
+			}
+			mantissa = mantissa * 10 + (*s - '0');
+			digits++;
+			if (point)
+				scale++;
+			if (digits > 15)
+				break;
+		}
+		else if (*s == '.' && !point)
+			point = true;
+		else
+			break;
+	}
+	if (s == end && any && scale <= 22)
+	{
+		value = (double)mantissa / powers[scale];
+		if (negative)
+			value = -value;
+		return true;
+	}
+	char number[64];
+	if (length <= 0 || length >= (int)sizeof(number))
+		return false;
+	memcpy(number, p, length);
+	number[length] = 0;
+	char *last;
+	value = strtod(number, &last);
+	return last == number + length;
+}
+
 bool DataStoreReader::readHeader(int &nContigs, int &nGroups, int &nLinks)
 {
-	string line;
-	getline(in, line);
-	string contigsStr = Helpers::NextEntry(line);
-	string groupsStr = Helpers::NextEntry(line);
-	string linksStr = Helpers::NextEntry(line);
-	if (contigsStr.length() == 0 || groupsStr.length() == 0 || linksStr.length() == 0)
+	const char *line, *lineEnd, *fields[3];
+	int lengths[3];
+	if (!nextLine(line, lineEnd))
+		return false;
+	splitFields(line, lineEnd, fields, lengths, 3);
+	if (!parseInt(fields[0], lengths[0], nContigs) || !parseInt(fields[1], lengths[1], nGroups) || !parseInt(fields[2], lengths[2], nLinks))
 		return false;
-	nContigs = Helpers::GetArgument<int>(contigsStr);
-	nGroups = Helpers::GetArgument<int>(groupsStr);
-	nLinks = Helpers::GetArgument<int>(linksStr);
 	if (nContigs <= 0 || nGroups <= 0 || nLinks < 0)
 		return false;
 	return true;
 }
 
-bool DataStoreReader::readContigs(int nContigs, DataStore &store)
+// In lengths-only mode the position of every sequence line is recorded instead of its contents.
+bool DataStoreReader::readContigs(int nContigs, DataStore &store, bool lengthsOnly)
 {
-	Contig contig;
-	int contigID;
+	shared_ptr<FastAIndex> index;
+	if (lengthsOnly && mapped)
+	{
+		index.reset(new FastAIndex());
+		if (!index->Attach(fileName))
+			return false;
+	}
+	const char *line, *lineEnd, *seq, *seqEnd, *fields[2];
+	int lengths[2];
 	for (int i = 0; i < nContigs; i++)
 	{
-		if (in.eof() || !readContig(contig, contigID))
+		if (!nextLine(line, lineEnd) || !nextLine(seq, seqEnd))
+			return false;
+		splitFields(line, lineEnd, fields, lengths, 2);
+		const char *seqTab = (const char *)memchr(seq, '\t', seqEnd - seq);
+		int seqLength = (seqTab != NULL ? seqTab : seqEnd) - seq;
+		int contigID;
+		if (!parseInt(fields[0], lengths[0], contigID) || lengths[1] == 0 || seqLength == 0)
 			return false;
+		Contig contig;
+		if (index)
+			contig = Contig(index, index->Add(string(fields[1], lengths[1]), seqLength, seq - data, seqEnd - seq));
+		else
+		{
+			contig.Comment.assign(fields[1], lengths[1]);
+			contig.Sequence.Append(seq, seqLength);
+		}
 		if (store.AddContig(contig) != contigID)
 			return false;
 	}
@@ -103,89 +330,119 @@ bool DataStoreReader::readContigs(int nContigs, DataStore &store)
 
 bool DataStoreReader::readGroups(int nGroups, DataStore &store)
 {
-	LinkGroup group("");
-	int groupId;
+	const char *line, *lineEnd, *fields[3];
+	int lengths[3];
 	for (int i = 0; i < nGroups; i++)
 	{
-		if (in.eof() || !readGroup(group, groupId))
+		int groupId;
+		if (!nextLine(line, lineEnd))
 			return false;
-		if (store.AddGroup(group) != groupId)
+		splitFields(line, lineEnd, fields, lengths, 3);
+		if (!parseInt(fields[0], lengths[0], groupId) || lengths[1] == 0)
+			return false;
+		if (store.AddGroup(LinkGroup(string(fields[1], lengths[1]), string(fields[2], lengths[2]))) != groupId)
 			return false;
 	}
 	return true;
 }
 
-bool DataStoreReader::readLinks(int nLinks, DataStore &store)
+bool DataStoreReader::readLink(const char *line, const char *lineEnd, int nContigs, int nGroups, int &groupID, ContigLink &link)
 {
-	int groupID;
-	ContigLink link;
-	for (int i = 0; i < nLinks; i++)
+	const char *fields[13];
+	int lengths[13];
+	int first, second, orientation, order, ambiguous;
+	double mean, std, weight;
+	splitFields(line, lineEnd, fields, lengths, 13);
+	if (!parseInt(fields[0], lengths[0], groupID) || groupID < 0 || groupID >= nGroups)
+		return false;
+	if (!parseInt(fields[1], lengths[1], first) || !parseInt(fields[2], lengths[2], second) || !parseInt(fields[3], lengths[3], orientation) || !parseInt(fields[4], lengths[4], order))
+		return false;
+	if (!parseDouble(fields[5], lengths[5], mean) || !parseDouble(fields[6], lengths[6], std) || !parseInt(fields[7], lengths[7], ambiguous) || !parseDouble(fields[8], lengths[8], weight))
+		return false;
+	if (first < 0 || first >= nContigs || second < 0 || second >= nContigs || weight <= 0)
+		return false;
+	link = ContigLink(first, second, mean, std, orientation == 1, order == 1, weight, string(fields[9], lengths[9]));
+	link.Ambiguous = ambiguous == 1;
+	// provenance is optional
+	if (lengths[10] > 0)
 	{
-		if (in.eof() || !readLink(groupID, link))
+		long long firstPair, lastPair;
+		if (!parseInt(fields[10], lengths[10], link.Provenance.Count) || !parseLong(fields[11], lengths[11], firstPair) || !parseLong(fields[12], lengths[12], lastPair))
 			return false;
-		store.AddLink(groupID, link);
+		link.Provenance.First = firstPair;
+		link.Provenance.Last = lastPair;
 	}
 	return true;
 }
 
-bool DataStoreReader::readContig(Contig &contig, int &id)
+// Parses up to limit links of one part of the link section. A line that does not parse
+// ends the chunk; whether that is an error depends on how many links were needed.
+void DataStoreReader::readLinkChunk(LinkChunk *chunk, int nContigs, int nGroups, int limit)
 {
-	string line, seq;
-	getline(in, line);
-	if (in.eof()) return false;
-	getline(in, seq);
-	string idStr = Helpers::NextEntry(line);
-	string commentStr = Helpers::NextEntry(line);
-	seq = Helpers::NextEntry(seq);
-	if (idStr.length() == 0 || commentStr.length() == 0 || seq.length() == 0)
-		return false;
-	id = Helpers::GetArgument<int>(idStr);
-	contig = Contig(FastASequence(seq, commentStr));
-	return true;
+	const char *p = chunk->Begin;
+	int groupID;
+	ContigLink link;
+	while (p < chunk->End && chunk->Links.Size() < limit)
+	{
+		const char *lineEnd = (const char *)memchr(p, '\n', chunk->End - p);
+		if (lineEnd == NULL)
+			lineEnd = chunk->End;
+		if (!readLink(p, lineEnd, nContigs, nGroups, groupID, link))
+		{
+			chunk->Failed = true;
+			return;
+		}
+		chunk->Links.Add(groupID, link);
+		p = lineEnd + 1;
+	}
 }
 
-bool DataStoreReader::readGroup(LinkGroup &group, int &id)
+// The link section is cut into chunks at line ends, the chunks are parsed in parallel and
+// their links are added to the store in file order in one go.
+bool DataStoreReader::readLinks(int nLinks, int nGroups, DataStore &store)
 {
-	string line;
-	getline(in, line);
-	string idStr = Helpers::NextEntry(line);
-	string nameStr = Helpers::NextEntry(line);
-	string descriptionStr = Helpers::NextEntry(line);
-	if (idStr.length() == 0 || nameStr.length() == 0)
-		return false;
-	id = Helpers::GetArgument<int>(idStr);
-	group = LinkGroup(nameStr, descriptionStr);
-	return true;
-}
+	if (nLinks == 0)
+		return true;
+	const char *begin = data + pos, *end = data + size;
+	long long length = end - begin;
+	int threads = max(1, (int)min<long long>(DataStore::Threads, length / MinimumChunkSize));
+	vector<LinkChunk> chunks(threads);
+	const char *p = begin;
+	for (int i = 0; i < threads; i++)
+	{
+		chunks[i].Begin = p;
+		if (i + 1 < threads)
+		{
+			const char *target = max(p, begin + length * (i + 1) / threads);
+			const char *lineEnd = (const char *)memchr(target, '\n', end - target);
+			p = (lineEnd == NULL ? end : lineEnd + 1);
+		}
+		else
+			p = end;
+		chunks[i].End = p;
+		chunks[i].Links.Reserve((chunks[i].End - chunks[i].Begin) / 48 + 1);
+	}
+	vector<thread> workers;
+	for (int i = 1; i < threads; i++)
+		workers.push_back(thread(&DataStoreReader::readLinkChunk, &chunks[i], store.ContigCount, nGroups, nLinks));
+	readLinkChunk(&chunks[0], store.ContigCount, nGroups, nLinks);
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
 
-bool DataStoreReader::readLink(int &groupID, ContigLink &link)
-{
-	string line;
-	getline(in, line);
-	string groupIdStr = Helpers::NextEntry(line);
-	string firstStr = Helpers::NextEntry(line);
-	string secondStr = Helpers::NextEntry(line);
-	string orientationStr = Helpers::NextEntry(line);
-	string orderStr = Helpers::NextEntry(line);
-	string meanStr = Helpers::NextEntry(line);
-	string stdStr = Helpers::NextEntry(line);
-	string ambiguousStr = Helpers::NextEntry(line);
-	string weightStr = Helpers::NextEntry(line);
-	string commentStr = Helpers::NextEntry(line);
-	if (firstStr.length() == 0 || secondStr.length() == 0 || orientationStr.length() == 0 || orderStr.length() == 0 || meanStr.length() == 0 || stdStr.length() == 0 || ambiguousStr.length() == 0 || weightStr.length() == 0)
-		return false;
-	groupID = Helpers::GetArgument<int>(groupIdStr);
-	int first = Helpers::GetArgument<int>(firstStr);
-	int second = Helpers::GetArgument<int>(secondStr);
-	bool equalOrientation = Helpers::GetArgument<int>(orientationStr) == 1;
-	bool forwardOrder = Helpers::GetArgument<int>(orderStr) == 1;
-	double mean = Helpers::GetArgument<double>(meanStr);
-	double std = Helpers::GetArgument<double>(stdStr);
-	bool ambiguous = Helpers::GetArgument<int>(ambiguousStr) == 1;
-	double weight = Helpers::GetArgument<double>(weightStr);
-	if (groupID < 0 || first < 0 || second < 0 || weight <= 0)
-		return false;
-	link = ContigLink(first, second, mean, std, equalOrientation, forwardOrder, weight, commentStr);
-	link.Ambiguous = ambiguous;
-	return true;
+	int needed = nLinks;
+	for (int i = 0; i < threads && needed > 0; i++)
+	{
+		// lines after the last link are ignored
+		if (chunks[i].Links.Size() > needed)
+		{
+			chunks[i].Links.Clear();
+			readLinkChunk(&chunks[i], store.ContigCount, nGroups, needed);
+		}
+		needed -= chunks[i].Links.Size();
+		if (needed > 0 && chunks[i].Failed)
+			return false;
+		store.AddLinks(chunks[i].Links);
+		chunks[i].Links.Clear();
+	}
+	return needed == 0;
 }
@@ -30,7 +30,7 @@
 #define _DATASTOREREADER_H
 
 #include <string>
-#include <fstream>
+#include <vector>
 #include "DataStore.h"
 
 using namespace std;
@@ -38,24 +38,44 @@ using namespace std;
 class DataStoreReader
 {
 public:
-	DataStoreReader() {};
+	DataStoreReader() : data(NULL), size(0), pos(0), mapped(false), opened(false) {};
 	virtual ~DataStoreReader();
 
 public:
 	bool Open(const string &fileName);
 	bool Close();
-	bool Read(DataStore &store);
+	// Reads text and binary stores. In lengths-only mode contig sequences are not loaded but indexed in the store file.
+	bool Read(DataStore &store, bool lengthsOnly = false);
 
 private:
+	class LinkChunk
+	{
+	public:
+		LinkChunk() : Begin(NULL), End(NULL), Failed(false) {};
+
+	public:
+		const char *Begin, *End;
+		LinkTable Links;
+		bool Failed;
+	};
+
+private:
+	bool readBinary(DataStore &store, bool lengthsOnly);
+	bool nextLine(const char *&line, const char *&lineEnd);
 	bool readHeader(int &nContigs, int &nGroups, int &nLinks);
-	bool readContigs(int nContigs, DataStore &store);
+	bool readContigs(int nContigs, DataStore &store, bool lengthsOnly);
 	bool readGroups(int nGroups, DataStore &store);
-	bool readLinks(int nLinks, DataStore &store);
-	bool readContig(Contig &contig, int &id);
-	bool readGroup(LinkGroup &group, int &id);
-	bool readLink(int &groupID, ContigLink &link);
+	bool readLinks(int nLinks, int nGroups, DataStore &store);
+	static void readLinkChunk(LinkChunk *chunk, int nContigs, int nGroups, int limit);
+	static bool readLink(const char *line, const char *lineEnd, int nContigs, int nGroups, int &groupID, ContigLink &link);
 
 protected:
-	fstream in;
+	string fileName;
+	const char *data;
+	long long size;
+	long long pos;
+	bool mapped;
+	bool opened;
+	vector<char> buffer;
 };
 #endif
@@ -27,6 +27,7 @@
 
 
 #include "DataStoreWriter.h"
+#include "BinaryDataStore.h"
 #include <cstdlib>
 #include <cstdio>
 
@@ -59,25 +60,64 @@ bool DataStoreWriter::Close()
 	return true;
 }
 
-bool DataStoreWriter::Write(const DataStore &store)
+bool DataStoreWriter::Write(const DataStore &store, bool binary)
 {
 	if (out == NULL)
 		return false;
+	if (binary)
+		return BinaryDataStore::Write(store, out);
+	if (!writeContigsAndGroups(store, store.LinkCount))
+		return false;
+	for (DataStore::LinkMap::const_iterator it = store.Begin(); it != store.End(); it++)
+		writeLink(it->second);
+	return true;
+}
+
+bool DataStoreWriter::Write(const DataStore &store, LinkSink &links, bool binary)
+{
+	if (out == NULL)
+		return false;
+	if (binary)
+		return BinaryDataStore::Write(store, links, out);
+	if (!links.Rewind() || !writeContigsAndGroups(store, links.Size()))
+		return false;
+	ContigLinkView link;
+	int nLinks = 0;
+	while (links.Next(link))
+	{
+		writeLink(link);
+		nLinks++;
+	}
+	return nLinks == links.Size();
+}
+
+bool DataStoreWriter::writeContigsAndGroups(const DataStore &store, int nLinks)
+{
 	int nContigs = store.ContigCount;
 	int nGroups = store.GroupCount;
-	int nLink = store.LinkCount;
-	fprintf(out, "%i\t%i\t%i\n", nContigs, nGroups, nLink);
+	fprintf(out, "%i\t%i\t%i\n", nContigs, nGroups, nLinks);
+	string seq;
 	for (int i = 0; i < nContigs; i++)
 	{
-		fprintf(out, "%i\t%s\n", store[i].GetID(), store[i].Sequence.Comment.c_str());
-		fprintf(out, "%s\n", store[i].Sequence.Nucleotides.c_str());
+		fprintf(out, "%i\t%s\n", store[i].GetID(), store[i].Comment.c_str());
+		if (!store[i].GetNucleotides(seq))
+			return false;
+		fprintf(out, "%s\n", seq.c_str());
 	}
 	for (int i = 0; i < nGroups; i++)
 	{
 		const LinkGroup &group = store.GetGroup(i);
 		fprintf(out, "%i\t%s\t%s\n", group.GetID(), group.Name.c_str(), group.Description.c_str());
 	}
-	for (DataStore::LinkMap::const_iterator it = store.Begin(); it != store.End(); it++)
-		fprintf(out, "%i\t%i\t%i\t%i\t%i\t%lf\t%lf\t%i\t%lf\t%s\n", it->second.GetGroupID(), it->first.first, it->first.second, (it->second.EqualOrientation ? 1 : 0), (it->second.ForwardOrder ? 1 : 0), it->second.Mean, it->second.Std, (it->second.Ambiguous ? 1 : 0), it->second.Weight, it->second.Comment.c_str());
 	return true;
 }
+
+// provenance follows the comment, only for links that have any
+void DataStoreWriter::writeLink(const ContigLinkView &link)
+{
+	const LinkProvenance &provenance = link.Provenance;
+	fprintf(out, "%i\t%i\t%i\t%i\t%i\t%lf\t%lf\t%i\t%lf\t%s", link.GetGroupID(), link.First, link.Second, (link.EqualOrientation ? 1 : 0), (link.ForwardOrder ? 1 : 0), link.Mean, link.Std, (link.Ambiguous ? 1 : 0), link.Weight, link.Comment);
+	if (provenance.IsRecorded() || provenance.Count != 1)
+		fprintf(out, "\t%i\t%lli\t%lli", provenance.Count, (long long)provenance.First, (long long)provenance.Last);
+	fprintf(out, "\n");
+}
@@ -32,6 +32,7 @@
 #include <cstddef>
 #include <string>
 #include "DataStore.h"
+#include "LinkSink.h"
 
 using namespace std;
 
@@ -44,7 +45,14 @@ public:
 public:
 	bool Open(const string &fileName, const string &mode = "wb");
 	bool Close();
-	bool Write(const DataStore &store);
+	// Writes the text format or, if binary is set, the mappable format of BinaryDataStore.
+	bool Write(const DataStore &store, bool binary = false);
+	// As above, but with the links collected in a sink instead of those of store.
+	bool Write(const DataStore &store, LinkSink &links, bool binary = false);
+
+protected:
+	bool writeContigsAndGroups(const DataStore &store, int nLinks);
+	void writeLink(const ContigLinkView &link);
 
 protected:
 	FILE *out;
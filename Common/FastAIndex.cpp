@@ -0,0 +1,96 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "FastAIndex.h"
+#include "Reader.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+FastAIndex::~FastAIndex()
+{
+	if (fd >= 0)
+		close(fd);
+}
+
+bool FastAIndex::Build(const string &fileName)
+{
+	MappedFastAReader reader;
+	if (!reader.Open(fileName) || !reader.IsMapped())
+		return false;
+	entries.clear();
+	FastARecord record;
+	while (reader.Next(record))
+		Add(record.Comment(), record.Length(), reader.Offset(record.Data), record.DataLength);
+	reader.Close();
+	return Attach(fileName);
+}
+
+bool FastAIndex::Attach(const string &fileName)
+{
+	if (fd >= 0)
+		close(fd);
+	this->fileName = fileName;
+	fd = open(fileName.c_str(), O_RDONLY);
+	return fd >= 0;
+}
+
+int FastAIndex::Add(const string &comment, long long length, long long offset, long long size)
+{
+	entries.push_back(FastAIndexEntry(comment, length, offset, size));
+	return entries.size() - 1;
+}
+
+int FastAIndex::Count() const
+{
+	return entries.size();
+}
+
+const FastAIndexEntry &FastAIndex::operator[] (int i) const
+{
+	return entries[i];
+}
+
+bool FastAIndex::Fetch(int i, string &nucleotides) const
+{
+	const FastAIndexEntry &entry = entries[i];
+	string data(entry.Size, '\0');
+	long long done = 0;
+	while (done < entry.Size)
+	{
+		ssize_t read = pread(fd, &data[done], entry.Size - done, entry.Offset + done);
+		if (read <= 0)
+			return false;
+		done += read;
+	}
+	FastARecord record;
+	record.Data = data.data();
+	record.DataLength = data.length();
+	record.GetNucleotides(nucleotides);
+	return (long long)nucleotides.length() == entry.Length;
+}
@@ -0,0 +1,84 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+/*
+ * Index of the sequences in a FastA (or DataStore) file, similar to a samtools
+ * .fai index: for every sequence its name, length and the byte range of its
+ * sequence lines. Sequences are read from the file on demand.
+ */
+
+#ifndef _FASTAINDEX_H
+#define _FASTAINDEX_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class FastAIndexEntry
+{
+public:
+	FastAIndexEntry(const string &comment, long long length, long long offset, long long size) : Comment(comment), Length(length), Offset(offset), Size(size) {};
+
+public:
+	// Full header line without the leading '>'
+	string Comment;
+	// Number of nucleotides
+	long long Length;
+	// Position and size of the sequence lines in the file
+	long long Offset;
+	long long Size;
+};
+
+class FastAIndex
+{
+public:
+	FastAIndex() : fd(-1) {};
+	~FastAIndex();
+
+public:
+	// Indexes a FastA file. Fails for input that cannot be read at random (compressed files, pipes).
+	bool Build(const string &fileName);
+	// Opens the file entries added with Add refer to.
+	bool Attach(const string &fileName);
+	int Add(const string &comment, long long length, long long offset, long long size);
+	int Count() const;
+	const FastAIndexEntry &operator[] (int i) const;
+	// Reads sequence i, dropping line ends and converting to upper case like the readers do. Safe to call from several threads.
+	bool Fetch(int i, string &nucleotides) const;
+
+private:
+	FastAIndex(const FastAIndex &);
+	FastAIndex &operator= (const FastAIndex &);
+
+private:
+	string fileName;
+	int fd;
+	vector<FastAIndexEntry> entries;
+};
+
+#endif
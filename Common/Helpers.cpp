@@ -32,6 +32,8 @@
 #include <cstdlib>
 #include <cmath>
 #include <cstring>
+#include <cstdio>
+#include <vector>
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -113,6 +115,14 @@ int Helpers::ParseInt(const char *str, bool &success)
 	return sgn * num;
 }
 
+double Helpers::ParseDouble(const char *str, bool &success)
+{
+	char *last;
+	double value = strtod(str, &last);
+	success = *str != 0 && *last == 0 && !isspace((unsigned char)*str) && std::isfinite(value);
+	return (success ? value : 0);
+}
+
 string Helpers::RandomString(int len, const char *alpha)
 {
 	int n = strlen(alpha);
@@ -145,6 +155,28 @@ bool Helpers::FileExists(const string &fileName)
 	return stat(fileName.c_str(), &s) == 0;
 }
 
+uint64_t Helpers::Hash(const void *data, size_t length, uint64_t hash)
+{
+	const unsigned char *p = (const unsigned char *)data;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ p[i]) * 1099511628211ULL;
+	return hash;
+}
+
+bool Helpers::HashFile(const string &fileName, uint64_t &hash)
+{
+	FILE *in = fopen(fileName.c_str(), "rb");
+	if (in == NULL)
+		return false;
+	vector<char> buffer(1 << 20);
+	size_t n;
+	while ((n = fread(&buffer[0], 1, buffer.size(), in)) > 0)
+		hash = Hash(&buffer[0], n, hash);
+	bool success = !ferror(in);
+	fclose(in);
+	return success;
+}
+
 bool Helpers::RemoveFile(const string &fileName)
 {
 	return remove(fileName.c_str()) == 0;
@@ -34,6 +34,7 @@
 #include <cmath>
 #include <string>
 #include <sstream>
+#include <stdint.h>
 
 using namespace std;
 
@@ -51,11 +52,17 @@ namespace Helpers
 	bool IsNumber(const char *str);
 	string ItoStr(int a);
 	int ParseInt(const char *str, bool &success);
+	// Parses a whole string as a finite decimal number.
+	double ParseDouble(const char *str, bool &success);
 	string TempFile(string path = "");
 	string RandomString(int len, const char *alpha = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ");
 	bool FileExists(const string &fileName);
 	bool RemoveFile(const string &fileName);
 	bool Execute(const string &cmd);
+	// 64-bit FNV-1a hash of data, continuing from hash.
+	uint64_t Hash(const void *data, size_t length, uint64_t hash = 14695981039346656037ULL);
+	// Hash of the contents of a file, continuing from hash.
+	bool HashFile(const string &fileName, uint64_t &hash);
 
 	void PrintDataStore(const DataStore &store);
 	template<class T>
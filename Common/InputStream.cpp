@@ -0,0 +1,421 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "InputStream.h"
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static int defaultThreads()
+{
+	int n = thread::hardware_concurrency();
+	return (n > 0 ? n : 1);
+}
+
+int InputStream::Threads = defaultThreads();
+
+InputFile::InputFile(FILE *file, bool owned, const string &prefix)
+	: file(file), owned(owned), prefix(prefix), prefixPos(0)
+{
+	struct stat s;
+	seekable = fstat(fileno(file), &s) == 0 && S_ISREG(s.st_mode);
+}
+
+InputFile::~InputFile()
+{
+	if (owned)
+		fclose(file);
+}
+
+size_t InputFile::Read(void *buf, size_t size)
+{
+	size_t read = 0;
+	if (prefixPos < prefix.length())
+	{
+		read = min(size, prefix.length() - prefixPos);
+		memcpy(buf, prefix.data() + prefixPos, read);
+		prefixPos += read;
+	}
+	if (read < size)
+		read += fread((char *)buf + read, 1, size - read, file);
+	return read;
+}
+
+// Only regular files can be rewound; the bytes of the detection prefix are then read from the file again.
+bool InputFile::Rewind()
+{
+	if (!seekable || fseek(file, 0, SEEK_SET) != 0)
+		return false;
+	prefixPos = prefix.length();
+	return true;
+}
+
+bool InputFile::Error() const
+{
+	return ferror(file) != 0;
+}
+
+bool InputFile::IsSeekable() const
+{
+	return seekable;
+}
+
+// Opens a file ("-" for standard input) and picks the stream matching its contents (plain, gzip or BGZF).
+InputStream *InputStream::Open(const string &fileName, const string &mode)
+{
+	bool standardInput = fileName == "-";
+	FILE *file = (standardInput ? stdin : fopen(fileName.c_str(), mode.c_str()));
+	if (file == NULL)
+		return NULL;
+	unsigned char header[18];
+	size_t read = 0, last;
+	while (read < sizeof(header) && (last = fread(header + read, 1, sizeof(header) - read, file)) > 0)
+		read += last;
+	InputFile *in = new InputFile(file, !standardInput, string((char *)header, read));
+	if (read >= 2 && header[0] == 0x1f && header[1] == 0x8b)
+	{
+		if (BgzfInputStream::IsBgzf(header, read))
+			return new BgzfInputStream(in, Threads);
+		return new GzipInputStream(in);
+	}
+	return new FileInputStream(in);
+}
+
+FileInputStream::~FileInputStream()
+{
+	delete in;
+}
+
+long long FileInputStream::Read(char *buf, long long size)
+{
+	size_t read = in->Read(buf, size);
+	if (read == 0 && in->Error())
+		return -1;
+	return read;
+}
+
+bool FileInputStream::Rewind()
+{
+	return in->Rewind();
+}
+
+bool FileInputStream::CanRewind() const
+{
+	return in->IsSeekable();
+}
+
+GzipInputStream::GzipInputStream(InputFile *file)
+	: in(file), buffer(1 << 18), finished(false), failed(false)
+{
+	memset(&strm, 0, sizeof(strm));
+	if (inflateInit2(&strm, 15 + 32) != Z_OK)
+		failed = true;
+}
+
+GzipInputStream::~GzipInputStream()
+{
+	inflateEnd(&strm);
+	delete in;
+}
+
+// Inflates the next bytes of the stream. Concatenated gzip members are read as one stream.
+long long GzipInputStream::Read(char *buf, long long size)
+{
+	if (failed)
+		return -1;
+	strm.next_out = (Bytef *)buf;
+	strm.avail_out = size;
+	while (strm.avail_out > 0 && !finished)
+	{
+		if (strm.avail_in == 0 && !fill())
+		{
+			// the input ended inside a member
+			if (strm.total_in > 0)
+				failed = true;
+			break;
+		}
+		int ret = inflate(&strm, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END)
+		{
+			// another gzip member may follow
+			if (strm.avail_in == 0 && !fill())
+				break;
+			inflateReset(&strm);
+		}
+		else if (ret != Z_OK && ret != Z_BUF_ERROR)
+		{
+			failed = true;
+			break;
+		}
+	}
+	if (failed)
+		return -1;
+	return size - strm.avail_out;
+}
+
+bool GzipInputStream::fill()
+{
+	size_t read = in->Read(&buffer[0], buffer.size());
+	if (read == 0)
+	{
+		failed = in->Error();
+		finished = true;
+		return false;
+	}
+	strm.next_in = &buffer[0];
+	strm.avail_in = read;
+	return true;
+}
+
+bool GzipInputStream::Rewind()
+{
+	if (!in->Rewind())
+		return false;
+	inflateReset(&strm);
+	strm.avail_in = 0;
+	finished = failed = false;
+	return true;
+}
+
+bool GzipInputStream::CanRewind() const
+{
+	return in->IsSeekable();
+}
+
+BgzfInputStream::BgzfInputStream(InputFile *file, int threads)
+	: in(file), threads(threads > 0 ? threads : 1), finished(false), stopping(false), failed(false)
+{
+	maxPending = 4 * this->threads + 4;
+	start();
+}
+
+BgzfInputStream::~BgzfInputStream()
+{
+	stop();
+	delete in;
+}
+
+// A BGZF block is a gzip member with FEXTRA set and a 'BC' subfield holding the block size.
+bool BgzfInputStream::IsBgzf(const unsigned char *header, size_t length)
+{
+	return length >= 18 && header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && (header[3] & 4) != 0
+		&& header[10] == 6 && header[11] == 0 && header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;
+}
+
+void BgzfInputStream::start()
+{
+	finished = stopping = failed = false;
+	reader = thread(&BgzfInputStream::readerLoop, this);
+	for (int i = 0; i < threads; i++)
+		workers.push_back(thread(&BgzfInputStream::workerLoop, this));
+}
+
+void BgzfInputStream::stop()
+{
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	if (reader.joinable())
+		reader.join();
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+		it->join();
+	workers.clear();
+	for (deque<Block *>::iterator it = pending.begin(); it != pending.end(); it++)
+		delete *it;
+	pending.clear();
+	jobs.clear();
+}
+
+void BgzfInputStream::readerLoop()
+{
+	while (true)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			while (!stopping && pending.size() >= maxPending)
+				changed.wait(guard);
+			if (stopping)
+				return;
+		}
+		Block *block = new Block();
+		bool blockFailed = false;
+		bool read = readBlock(*block, blockFailed);
+		unique_lock<mutex> guard(lock);
+		if (!read)
+		{
+			delete block;
+			finished = true;
+			failed = blockFailed;
+			changed.notify_all();
+			return;
+		}
+		pending.push_back(block);
+		jobs.push_back(block);
+		changed.notify_all();
+	}
+}
+
+void BgzfInputStream::workerLoop()
+{
+	while (true)
+	{
+		Block *block;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!stopping && jobs.empty())
+				changed.wait(guard);
+			if (stopping)
+				return;
+			block = jobs.front();
+			jobs.pop_front();
+		}
+		inflateBlock(*block);
+		unique_lock<mutex> guard(lock);
+		block->Done = true;
+		changed.notify_all();
+	}
+}
+
+// Reads the next block from the file. Returns false at the end of the file or on a malformed block.
+bool BgzfInputStream::readBlock(Block &block, bool &failed)
+{
+	unsigned char header[18];
+	size_t read = in->Read(header, sizeof(header));
+	if (read == 0)
+	{
+		failed = in->Error();
+		return false;
+	}
+	if (!IsBgzf(header, read))
+	{
+		failed = true;
+		return false;
+	}
+	int blockSize = (header[16] | (header[17] << 8)) + 1;
+	int remaining = blockSize - (int)sizeof(header);
+	if (remaining < 8)
+	{
+		failed = true;
+		return false;
+	}
+	block.Compressed.resize(remaining);
+	if (in->Read(&block.Compressed[0], remaining) != (size_t)remaining)
+	{
+		failed = true;
+		return false;
+	}
+	return true;
+}
+
+void BgzfInputStream::inflateBlock(Block &block)
+{
+	const unsigned char *trailer = &block.Compressed[block.Compressed.size() - 8];
+	uLong crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((uLong)trailer[3] << 24);
+	uLong size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((uLong)trailer[7] << 24);
+	// a BGZF block holds at most 64 KiB, so a larger size comes from a corrupt trailer
+	if (size > 65536)
+	{
+		block.Failed = true;
+		return;
+	}
+	block.Data.resize(size);
+	if (size == 0)
+		return;
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if (inflateInit2(&strm, -15) != Z_OK)
+	{
+		block.Failed = true;
+		return;
+	}
+	strm.next_in = &block.Compressed[0];
+	strm.avail_in = block.Compressed.size() - 8;
+	strm.next_out = (Bytef *)&block.Data[0];
+	strm.avail_out = size;
+	int ret = inflate(&strm, Z_FINISH);
+	inflateEnd(&strm);
+	if (ret != Z_STREAM_END || strm.total_out != size || crc32(crc32(0L, Z_NULL, 0), (Bytef *)&block.Data[0], size) != crc)
+		block.Failed = true;
+	vector<unsigned char>().swap(block.Compressed);
+}
+
+long long BgzfInputStream::Read(char *buf, long long size)
+{
+	long long copied = 0;
+	while (copied < size)
+	{
+		Block *block;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!(pending.empty() ? finished : pending.front()->Done))
+				changed.wait(guard);
+			if (pending.empty())
+			{
+				if (failed)
+					return -1;
+				break;
+			}
+			block = pending.front();
+		}
+		if (block->Failed)
+			return -1;
+		size_t left = block->Data.size() - block->Offset;
+		size_t count = (size_t)(size - copied) < left ? (size_t)(size - copied) : left;
+		if (count > 0)
+			memcpy(buf + copied, &block->Data[block->Offset], count);
+		block->Offset += count;
+		copied += count;
+		if (block->Offset == block->Data.size())
+		{
+			unique_lock<mutex> guard(lock);
+			pending.pop_front();
+			delete block;
+			changed.notify_all();
+		}
+	}
+	return copied;
+}
+
+bool BgzfInputStream::Rewind()
+{
+	if (!in->IsSeekable())
+		return false;
+	stop();
+	bool rewound = in->Rewind();
+	start();
+	return rewound;
+}
+
+bool BgzfInputStream::CanRewind() const
+{
+	return in->IsSeekable();
+}
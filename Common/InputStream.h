@@ -0,0 +1,182 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+
+/*
+ * Byte input streams used by the sequence readers. Plain, gzip and BGZF
+ * compressed files are detected by their magic bytes. Streams never need to
+ * seek unless rewound, so pipes and standard input ("-") can be read as well.
+ */
+
+#ifndef _INPUTSTREAM_H
+#define _INPUTSTREAM_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+using namespace std;
+
+// File handle that first replays the bytes consumed while detecting the
+// format, so no seek is needed after detection.
+class InputFile
+{
+public:
+	InputFile(FILE *file, bool owned, const string &prefix);
+	~InputFile();
+
+public:
+	size_t Read(void *buf, size_t size);
+	bool Rewind();
+	bool Error() const;
+	bool IsSeekable() const;
+
+private:
+	FILE *file;
+	bool owned;
+	bool seekable;
+	string prefix;
+	size_t prefixPos;
+};
+
+class InputStream
+{
+public:
+	InputStream() {};
+	virtual ~InputStream() {};
+
+public:
+	// Reads up to size bytes into buf. Returns the number of bytes read, 0 at the end of the stream and -1 on error.
+	virtual long long Read(char *buf, long long size) = 0;
+	virtual bool Rewind() = 0;
+	virtual bool CanRewind() const = 0;
+
+public:
+	static InputStream *Open(const string &fileName, const string &mode = "rb");
+
+public:
+	// Number of worker threads used to inflate BGZF blocks.
+	static int Threads;
+};
+
+class FileInputStream : public InputStream
+{
+public:
+	FileInputStream(InputFile *file) : in(file) {};
+	virtual ~FileInputStream();
+
+public:
+	long long Read(char *buf, long long size);
+	bool Rewind();
+	bool CanRewind() const;
+
+private:
+	InputFile *in;
+};
+
+class GzipInputStream : public InputStream
+{
+public:
+	GzipInputStream(InputFile *file);
+	virtual ~GzipInputStream();
+
+public:
+	long long Read(char *buf, long long size);
+	bool Rewind();
+	bool CanRewind() const;
+
+private:
+	bool fill();
+
+private:
+	InputFile *in;
+	z_stream strm;
+	vector<unsigned char> buffer;
+	bool finished;
+	bool failed;
+};
+
+// Inflates BGZF blocks on a pool of worker threads. A reader thread splits
+// the file into blocks and the consumer returns their contents in file order.
+class BgzfInputStream : public InputStream
+{
+public:
+	BgzfInputStream(InputFile *file, int threads);
+	virtual ~BgzfInputStream();
+
+public:
+	long long Read(char *buf, long long size);
+	bool Rewind();
+	bool CanRewind() const;
+
+public:
+	static bool IsBgzf(const unsigned char *header, size_t length);
+
+private:
+	class Block
+	{
+	public:
+		Block() : Offset(0), Done(false), Failed(false) {};
+
+	public:
+		vector<unsigned char> Compressed;
+		vector<char> Data;
+		size_t Offset;
+		bool Done;
+		bool Failed;
+	};
+
+private:
+	void start();
+	void stop();
+	void readerLoop();
+	void workerLoop();
+	bool readBlock(Block &block, bool &failed);
+	static void inflateBlock(Block &block);
+
+private:
+	InputFile *in;
+	int threads;
+	size_t maxPending;
+	thread reader;
+	vector<thread> workers;
+	mutex lock;
+	condition_variable changed;
+	deque<Block *> pending;
+	deque<Block *> jobs;
+	bool finished;
+	bool stopping;
+	bool failed;
+};
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "LinkSink.h"
+#include "Helpers.h"
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+using namespace std;
+
+// Fixed part of a link in a run file; the comment follows it.
+struct LinkRecord
+{
+	int32_t First, Second, Group, ReadPairs;
+	double Mean, Std, Weight;
+	int64_t FirstReadPair, LastReadPair;
+	int32_t CommentLength;
+	uint8_t Flags;
+};
+
+LinkSink::LinkSink(size_t memoryLimit, const string &scratchPath)
+	: memoryLimit(memoryLimit), scratchPath(scratchPath), count(0), reading(false), failed(false), position(0)
+{
+}
+
+LinkSink::~LinkSink()
+{
+	clearRuns();
+}
+
+bool LinkSink::Add(int groupId, const ContigLink &link)
+{
+	if (reading || failed)
+		return false;
+	buffer.Add(groupId, link);
+	count++;
+	if (memoryLimit > 0 && buffer.MemoryUsage() > memoryLimit)
+		return spill();
+	return true;
+}
+
+bool LinkSink::Failed() const
+{
+	return failed;
+}
+
+int LinkSink::Size() const
+{
+	return count;
+}
+
+int LinkSink::Runs() const
+{
+	return runs.size();
+}
+
+const string &LinkSink::ScratchPath() const
+{
+	return scratchPath;
+}
+
+// Run files are removed as soon as they are opened, so they disappear with the process.
+FILE *LinkSink::createRun()
+{
+	string fileName = Helpers::TempFile(scratchPath);
+	FILE *file = fopen(fileName.c_str(), "w+b");
+	if (file == NULL)
+	{
+		failed = true;
+		return NULL;
+	}
+	Helpers::RemoveFile(fileName);
+	return file;
+}
+
+// Whenever the last MergeFanIn runs are of one level they are merged into one run a level
+// up. Levels only fall towards the end of the list, so merged runs are always the latest
+// ones and at most MergeFanIn - 1 runs per level stay open.
+bool LinkSink::spill()
+{
+	FILE *file = createRun();
+	if (file == NULL)
+		return false;
+	bool success = true;
+	for (LinkTable::const_iterator it = buffer.Begin(); success && it != buffer.End(); it++)
+		success = writeLink(file, it->second);
+	success = success && fflush(file) == 0;
+	buffer.Clear();
+	runs.push_back(Run());
+	runs.back().File = file;
+	failed = !success;
+	while (success && (int)runs.size() >= MergeFanIn && runs[runs.size() - MergeFanIn].Level == runs.back().Level)
+		success = mergeRuns(runs.size() - MergeFanIn);
+	return success;
+}
+
+// Replaces the runs from index from on by a single run holding their links in merge order.
+bool LinkSink::mergeRuns(int from)
+{
+	FILE *file = createRun();
+	if (file == NULL)
+		return false;
+	vector<int> merging;
+	bool success = startMerge(from, merging);
+	ContigLink link;
+	ContigLinkView linkView;
+	int groupId;
+	while (success && !merging.empty())
+	{
+		success = nextMerged(merging, link, groupId);
+		view(link, groupId, linkView);
+		success = success && writeLink(file, linkView);
+	}
+	success = success && fflush(file) == 0;
+	int level = runs[from].Level + 1;
+	for (int i = from; i < (int)runs.size(); i++)
+		fclose(runs[i].File);
+	runs.resize(from);
+	runs.push_back(Run());
+	runs.back().File = file;
+	runs.back().Level = level;
+	failed = !success;
+	return success;
+}
+
+// Reads the first link of every run from index from on and orders them in heap.
+bool LinkSink::startMerge(int from, vector<int> &heap)
+{
+	bool success = true;
+	heap.clear();
+	for (int i = from; i < (int)runs.size(); i++)
+	{
+		rewind(runs[i].File);
+		if (readLink(runs[i].File, runs[i].Link, runs[i].GroupID))
+			heap.push_back(i);
+		else if (ferror(runs[i].File))
+			success = false;
+	}
+	make_heap(heap.begin(), heap.end(), RunOrder(runs));
+	return success;
+}
+
+// Takes the smallest link off a non-empty heap and reads the next link of its run.
+bool LinkSink::nextMerged(vector<int> &heap, ContigLink &link, int &groupId)
+{
+	RunOrder order(runs);
+	pop_heap(heap.begin(), heap.end(), order);
+	Run &run = runs[heap.back()];
+	link = run.Link;
+	groupId = run.GroupID;
+	if (readLink(run.File, run.Link, run.GroupID))
+		push_heap(heap.begin(), heap.end(), order);
+	else if (ferror(run.File))
+		return false;
+	else
+		heap.pop_back();
+	return true;
+}
+
+void LinkSink::view(const ContigLink &link, int groupId, ContigLinkView &view)
+{
+	view.First = link.First;
+	view.Second = link.Second;
+	view.Mean = link.Mean;
+	view.Std = link.Std;
+	view.EqualOrientation = link.EqualOrientation;
+	view.ForwardOrder = link.ForwardOrder;
+	view.Weight = link.Weight;
+	view.Ambiguous = link.Ambiguous;
+	view.Comment = link.Comment.c_str();
+	view.Provenance = link.Provenance;
+	view.groupId = groupId;
+}
+
+bool LinkSink::writeLink(FILE *out, const ContigLinkView &link)
+{
+	LinkRecord record;
+	memset(&record, 0, sizeof(record));
+	record.First = link.First;
+	record.Second = link.Second;
+	record.Group = link.GetGroupID();
+	record.ReadPairs = link.Provenance.Count;
+	record.Mean = link.Mean;
+	record.Std = link.Std;
+	record.Weight = link.Weight;
+	record.FirstReadPair = link.Provenance.First;
+	record.LastReadPair = link.Provenance.Last;
+	record.CommentLength = strlen(link.Comment);
+	record.Flags = (link.EqualOrientation ? LinkTable::EqualOrientation : 0) | (link.ForwardOrder ? LinkTable::ForwardOrder : 0) | (link.Ambiguous ? LinkTable::Ambiguous : 0);
+	return fwrite(&record, sizeof(record), 1, out) == 1 && fwrite(link.Comment, 1, record.CommentLength, out) == (size_t)record.CommentLength;
+}
+
+bool LinkSink::readLink(FILE *in, ContigLink &link, int &groupId)
+{
+	LinkRecord record;
+	if (fread(&record, sizeof(record), 1, in) != 1)
+		return false;
+	link = ContigLink(record.First, record.Second, record.Mean, record.Std, (record.Flags & LinkTable::EqualOrientation) != 0, (record.Flags & LinkTable::ForwardOrder) != 0, record.Weight, string(), LinkProvenance(record.ReadPairs, record.FirstReadPair, record.LastReadPair));
+	link.Ambiguous = (record.Flags & LinkTable::Ambiguous) != 0;
+	groupId = record.Group;
+	link.Comment.resize(record.CommentLength);
+	return record.CommentLength == 0 || fread(&link.Comment[0], 1, record.CommentLength, in) == (size_t)record.CommentLength;
+}
+
+void LinkSink::clearRuns()
+{
+	for (vector<Run>::iterator it = runs.begin(); it != runs.end(); it++)
+		if (it->File != NULL)
+			fclose(it->File);
+	runs.clear();
+}
+
+// Links that never left memory are read from the buffer; otherwise the rest of the
+// buffer is spilled too and all runs are merged.
+bool LinkSink::Rewind()
+{
+	if (reading || failed)
+		return false;
+	reading = true;
+	position = 0;
+	if (runs.empty())
+	{
+		buffer.BuildIndex();
+		return true;
+	}
+	if (buffer.Size() > 0 && !spill())
+		return false;
+	failed = !startMerge(0, heap);
+	return !failed;
+}
+
+bool LinkSink::Next(ContigLinkView &link)
+{
+	if (!reading || failed)
+		return false;
+	if (runs.empty())
+	{
+		if (position >= buffer.Size())
+			return false;
+		link = LinkTable::const_iterator(&buffer, position++)->second;
+		return true;
+	}
+	if (heap.empty())
+		return false;
+	int groupId;
+	failed = !nextMerged(heap, current, groupId);
+	view(current, groupId, link);
+	return !failed;
+}
+
+bool LinkSink::RunOrder::operator() (int a, int b) const
+{
+	const ContigLink &x = runs[a].Link, &y = runs[b].Link;
+	if (x.First != y.First)
+		return x.First > y.First;
+	if (x.Second != y.Second)
+		return x.Second > y.Second;
+	return a > b;
+}
@@ -0,0 +1,118 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#ifndef _LINKSINK_H
+#define _LINKSINK_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "DataStore.h"
+
+using namespace std;
+
+// Collects links within a memory budget. Links are buffered in a LinkTable; whenever it
+// outgrows the budget it is sorted and spilled as a run to a scratch file. Reading the
+// links back merges the runs in store order, links between the same contigs in the
+// order they were added, as a DataStore holding all of them would list them. Runs are
+// merged MergeFanIn at a time as they pile up, so few files are open however many spill.
+class LinkSink
+{
+public:
+	// A memory limit of 0 keeps all links in memory.
+	LinkSink(size_t memoryLimit = 0, const string &scratchPath = "");
+	virtual ~LinkSink();
+
+public:
+	// Fails, as does every later call, once a run cannot be spilled.
+	bool Add(int groupId, const ContigLink &link);
+	// Whether spilling or reading back a run has failed.
+	bool Failed() const;
+	int Size() const;
+	// Number of runs spilled so far.
+	int Runs() const;
+	const string &ScratchPath() const;
+	// Starts reading the links in store order. No links can be added afterwards.
+	bool Rewind();
+	// Reads the next link; its comment stays valid until the next call.
+	bool Next(ContigLinkView &link);
+
+private:
+	LinkSink(const LinkSink &);
+	LinkSink &operator= (const LinkSink &);
+
+	// A spilled run being merged, holding its next link. A run made by merging runs of
+	// level l has level l + 1.
+	class Run
+	{
+	public:
+		Run() : File(NULL), GroupID(-1), Level(0) {};
+
+	public:
+		FILE *File;
+		ContigLink Link;
+		int GroupID;
+		int Level;
+	};
+
+	// Orders the heads of the runs by contigs, ties by run, for a min-heap.
+	class RunOrder
+	{
+	public:
+		RunOrder(const vector<Run> &runs) : runs(runs) {};
+		bool operator() (int a, int b) const;
+
+	private:
+		const vector<Run> &runs;
+	};
+
+	static const int MergeFanIn = 64;
+
+private:
+	bool spill();
+	FILE *createRun();
+	bool mergeRuns(int from);
+	bool startMerge(int from, vector<int> &heap);
+	bool nextMerged(vector<int> &heap, ContigLink &link, int &groupId);
+	static void view(const ContigLink &link, int groupId, ContigLinkView &view);
+	static bool writeLink(FILE *out, const ContigLinkView &link);
+	static bool readLink(FILE *in, ContigLink &link, int &groupId);
+	void clearRuns();
+
+private:
+	size_t memoryLimit;
+	string scratchPath;
+	LinkTable buffer;
+	int count;
+	bool reading, failed;
+	vector<Run> runs;
+	vector<int> heap;
+	int position;
+	ContigLink current;
+};
+#endif
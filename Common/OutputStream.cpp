@@ -0,0 +1,241 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "OutputStream.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+static int defaultThreads()
+{
+	int n = thread::hardware_concurrency();
+	return (n > 0 ? n : 1);
+}
+
+int OutputStream::Threads = defaultThreads();
+const size_t BgzfOutputStream::BlockSize;
+
+OutputStream *OutputStream::Open(const string &fileName, const string &mode, bool compressed)
+{
+	bool standardOutput = fileName == "-";
+	FILE *file = (standardOutput ? stdout : fopen(fileName.c_str(), mode.c_str()));
+	if (file == NULL)
+		return NULL;
+	if (compressed)
+		return new BgzfOutputStream(file, !standardOutput, Threads);
+	return new FileOutputStream(file, !standardOutput);
+}
+
+bool OutputStream::IsCompressedName(const string &fileName)
+{
+	size_t n = fileName.length();
+	return (n > 3 && fileName.compare(n - 3, 3, ".gz") == 0) || (n > 4 && fileName.compare(n - 4, 4, ".bgz") == 0);
+}
+
+FileOutputStream::~FileOutputStream()
+{
+	Close();
+}
+
+bool FileOutputStream::Write(const char *buf, size_t size)
+{
+	if (out == NULL || failed)
+		return false;
+	if (size > 0 && fwrite(buf, 1, size, out) != size)
+		failed = true;
+	return !failed;
+}
+
+bool FileOutputStream::Close()
+{
+	if (out == NULL)
+		return !failed;
+	if (fflush(out) != 0)
+		failed = true;
+	if (owned && fclose(out) != 0)
+		failed = true;
+	out = NULL;
+	return !failed;
+}
+
+BgzfOutputStream::BgzfOutputStream(FILE *file, bool owned, int threads, int level)
+	: out(file), owned(owned), threads(threads > 0 ? threads : 1), level(level), closing(false), failed(false)
+{
+	maxPending = 4 * this->threads + 4;
+	current = new Block();
+	current->Data.reserve(BlockSize);
+	writer = thread(&BgzfOutputStream::writerLoop, this);
+	for (int i = 0; i < this->threads; i++)
+		workers.push_back(thread(&BgzfOutputStream::workerLoop, this));
+}
+
+BgzfOutputStream::~BgzfOutputStream()
+{
+	Close();
+}
+
+bool BgzfOutputStream::Write(const char *buf, size_t size)
+{
+	if (out == NULL)
+		return false;
+	while (size > 0)
+	{
+		size_t count = min(size, BlockSize - current->Data.size());
+		current->Data.insert(current->Data.end(), buf, buf + count);
+		buf += count;
+		size -= count;
+		if (current->Data.size() == BlockSize)
+			submit();
+	}
+	unique_lock<mutex> guard(lock);
+	return !failed;
+}
+
+// Queues the current block for compression, waiting while too many blocks are in flight.
+void BgzfOutputStream::submit()
+{
+	Block *block = current;
+	current = new Block();
+	current->Data.reserve(BlockSize);
+	unique_lock<mutex> guard(lock);
+	while (pending.size() >= maxPending)
+		changed.wait(guard);
+	pending.push_back(block);
+	jobs.push_back(block);
+	changed.notify_all();
+}
+
+void BgzfOutputStream::workerLoop()
+{
+	while (true)
+	{
+		Block *block;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!closing && jobs.empty())
+				changed.wait(guard);
+			if (jobs.empty())
+				return;
+			block = jobs.front();
+			jobs.pop_front();
+		}
+		deflateBlock(*block);
+		unique_lock<mutex> guard(lock);
+		block->Done = true;
+		changed.notify_all();
+	}
+}
+
+void BgzfOutputStream::writerLoop()
+{
+	while (true)
+	{
+		Block *block;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!(pending.empty() ? closing : pending.front()->Done))
+				changed.wait(guard);
+			if (pending.empty())
+				return;
+			block = pending.front();
+		}
+		bool written = fwrite(&block->Compressed[0], 1, block->Compressed.size(), out) == block->Compressed.size();
+		unique_lock<mutex> guard(lock);
+		if (!written)
+			failed = true;
+		pending.pop_front();
+		delete block;
+		changed.notify_all();
+	}
+}
+
+// Compresses a block into a complete BGZF member. Data that does not shrink
+// below the 64 KB block limit is stored uncompressed.
+void BgzfOutputStream::deflateBlock(Block &block) const
+{
+	static const unsigned char header[18] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+	const size_t maxBlock = 0x10000;
+	uLong size = block.Data.size();
+	block.Compressed.resize(maxBlock);
+	memcpy(&block.Compressed[0], header, sizeof(header));
+	size_t length = 0;
+	for (int attempt = 0; attempt < 2 && length == 0; attempt++)
+	{
+		z_stream strm;
+		memset(&strm, 0, sizeof(strm));
+		if (deflateInit2(&strm, attempt == 0 ? level : Z_NO_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			continue;
+		strm.next_in = (Bytef *)(size > 0 ? &block.Data[0] : NULL);
+		strm.avail_in = size;
+		strm.next_out = &block.Compressed[sizeof(header)];
+		strm.avail_out = maxBlock - sizeof(header) - 8;
+		if (deflate(&strm, Z_FINISH) == Z_STREAM_END)
+			length = sizeof(header) + strm.total_out + 8;
+		deflateEnd(&strm);
+	}
+	uLong crc = crc32(crc32(0L, Z_NULL, 0), (Bytef *)(size > 0 ? &block.Data[0] : NULL), size);
+	unsigned char *p = &block.Compressed[0];
+	p[16] = (length - 1) & 0xff;
+	p[17] = ((length - 1) >> 8) & 0xff;
+	p += length - 8;
+	for (int i = 0; i < 4; i++)
+		p[i] = (crc >> (8 * i)) & 0xff;
+	for (int i = 0; i < 4; i++)
+		p[4 + i] = (size >> (8 * i)) & 0xff;
+	block.Compressed.resize(length);
+	vector<char>().swap(block.Data);
+}
+
+// Writes the remaining data followed by the empty end-of-file block.
+bool BgzfOutputStream::Close()
+{
+	if (out == NULL)
+		return !failed;
+	if (!current->Data.empty())
+		submit();
+	delete current;
+	current = new Block();
+	submit();
+	{
+		unique_lock<mutex> guard(lock);
+		closing = true;
+	}
+	changed.notify_all();
+	writer.join();
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+		it->join();
+	workers.clear();
+	delete current;
+	current = NULL;
+	if (fflush(out) != 0)
+		failed = true;
+	if (owned && fclose(out) != 0)
+		failed = true;
+	out = NULL;
+	return !failed;
+}
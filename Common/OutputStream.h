@@ -0,0 +1,138 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+/*
+ * Byte output streams used by the sequence writers. Output is either written
+ * to a plain file or compressed into BGZF blocks by background threads, which
+ * gives a gzip compatible file that the input streams can read in parallel.
+ */
+
+#ifndef _OUTPUTSTREAM_H
+#define _OUTPUTSTREAM_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+using namespace std;
+
+class OutputStream
+{
+public:
+	OutputStream() {};
+	virtual ~OutputStream() {};
+
+public:
+	// Writes size bytes from buf. Returns false on error.
+	virtual bool Write(const char *buf, size_t size) = 0;
+	// Flushes all pending output and closes the file. Returns false if any write failed.
+	virtual bool Close() = 0;
+
+public:
+	// Opens a file ("-" for standard output), compressing it as BGZF if requested.
+	static OutputStream *Open(const string &fileName, const string &mode = "wb", bool compressed = false);
+	// Returns true if the file name asks for compressed output (.gz or .bgz).
+	static bool IsCompressedName(const string &fileName);
+
+public:
+	// Number of compression threads used by BGZF streams.
+	static int Threads;
+};
+
+class FileOutputStream : public OutputStream
+{
+public:
+	FileOutputStream(FILE *file, bool owned) : out(file), owned(owned), failed(false) {};
+	virtual ~FileOutputStream();
+
+public:
+	bool Write(const char *buf, size_t size);
+	bool Close();
+
+private:
+	FILE *out;
+	bool owned;
+	bool failed;
+};
+
+// Producer fills blocks of at most BlockSize bytes, worker threads deflate
+// them and a writer thread stores the compressed blocks in their original order.
+class BgzfOutputStream : public OutputStream
+{
+public:
+	BgzfOutputStream(FILE *file, bool owned, int threads, int level = Z_DEFAULT_COMPRESSION);
+	virtual ~BgzfOutputStream();
+
+public:
+	bool Write(const char *buf, size_t size);
+	bool Close();
+
+public:
+	static const size_t BlockSize = 0xff00;
+
+private:
+	class Block
+	{
+	public:
+		Block() : Done(false) {};
+
+	public:
+		vector<char> Data;
+		vector<unsigned char> Compressed;
+		bool Done;
+	};
+
+private:
+	void submit();
+	void writerLoop();
+	void workerLoop();
+	void deflateBlock(Block &block) const;
+
+private:
+	FILE *out;
+	bool owned;
+	int threads;
+	int level;
+	size_t maxPending;
+	Block *current;
+	thread writer;
+	vector<thread> workers;
+	mutex lock;
+	condition_variable changed;
+	deque<Block *> pending;
+	deque<Block *> jobs;
+	bool closing;
+	bool failed;
+};
+
+#endif
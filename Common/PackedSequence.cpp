@@ -0,0 +1,204 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "PackedSequence.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// Lookup tables shared by all sequences: 2-bit code of every character (4 for
+// characters kept as exceptions), the four characters encoded by every byte
+// of packed data and the complement of every character.
+class PackedTables
+{
+public:
+	PackedTables()
+	{
+		static const char bases[] = "ACGT";
+		for (int c = 0; c < 256; c++)
+			Code[c] = 4;
+		for (int i = 0; i < 4; i++)
+			Code[(unsigned char)bases[i]] = i;
+		for (int b = 0; b < 256; b++)
+			for (int k = 0; k < 4; k++)
+				Decode[b][k] = bases[(b >> (2 * k)) & 3];
+		for (int c = 0; c < 256; c++)
+			Complement[c] = 'N';
+		const char *from = "ATCGatcgNn*", *to = "TAGCtagcNn*";
+		for (int i = 0; from[i]; i++)
+			Complement[(unsigned char)from[i]] = to[i];
+	}
+
+public:
+	unsigned char Code[256];
+	char Decode[256][4];
+	char Complement[256];
+};
+
+static const PackedTables tables;
+
+PackedSequence::PackedSequence(const string &nucleotides)
+	: length(0)
+{
+	Assign(nucleotides);
+}
+
+void PackedSequence::Assign(const string &nucleotides)
+{
+	Clear();
+	Reserve(nucleotides.length());
+	Append(nucleotides.data(), nucleotides.length());
+}
+
+void PackedSequence::Clear()
+{
+	words.clear();
+	exceptions.clear();
+	length = 0;
+}
+
+void PackedSequence::Append(const char *nucleotides, size_t count)
+{
+	words.resize((length + count + BasesPerWord - 1) / BasesPerWord, 0);
+	for (size_t i = 0; i < count; i++, length++)
+	{
+		unsigned char c = nucleotides[i];
+		unsigned char code = tables.Code[c];
+		if (code < 4)
+			words[length / BasesPerWord] |= (uint64_t)code << (2 * (length % BasesPerWord));
+		else if (!exceptions.empty() && exceptions.back().Base == (char)c && exceptions.back().Start + exceptions.back().Length == length)
+			exceptions.back().Length++;
+		else
+			exceptions.push_back(Exception(length, 1, c));
+	}
+}
+
+void PackedSequence::Reserve(size_t count)
+{
+	words.reserve((count + BasesPerWord - 1) / BasesPerWord);
+}
+
+size_t PackedSequence::Length() const
+{
+	return length;
+}
+
+char PackedSequence::At(size_t i) const
+{
+	if (!exceptions.empty())
+	{
+		// last run starting at or before i
+		size_t lo = 0, hi = exceptions.size();
+		while (lo < hi)
+		{
+			size_t mid = (lo + hi) / 2;
+			if (exceptions[mid].Start <= i)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo > 0 && i < exceptions[lo - 1].Start + exceptions[lo - 1].Length)
+			return exceptions[lo - 1].Base;
+	}
+	return "ACGT"[(words[i / BasesPerWord] >> (2 * (i % BasesPerWord))) & 3];
+}
+
+// Expands every byte of packed data into four characters with a single table
+// lookup, then overwrites the exception runs.
+void PackedSequence::Unpack(string &nucleotides) const
+{
+	nucleotides.resize(words.size() * BasesPerWord);
+	char *out = &nucleotides[0];
+	for (size_t i = 0; i < words.size(); i++)
+	{
+		uint64_t word = words[i];
+		for (int j = 0; j < 8; j++, out += 4, word >>= 8)
+			memcpy(out, tables.Decode[word & 0xff], 4);
+	}
+	nucleotides.resize(length);
+	for (size_t i = 0; i < exceptions.size(); i++)
+		memset(&nucleotides[exceptions[i].Start], exceptions[i].Base, exceptions[i].Length);
+}
+
+string PackedSequence::Unpack() const
+{
+	string nucleotides;
+	Unpack(nucleotides);
+	return nucleotides;
+}
+
+// Reverses the 2-bit fields of a word: swap neighbouring fields, then nibbles,
+// then bytes.
+static inline uint64_t reverseFields(uint64_t x)
+{
+	x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+	x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((x & 0x0f0f0f0f0f0f0f0fULL) << 4);
+	return __builtin_bswap64(x);
+}
+
+// With A=0, C=1, G=2 and T=3 the complement of a base is its code xor 3, so a
+// whole word of 32 bases is reversed and complemented with a few word
+// operations. The padding of the last word ends up in front and is shifted out.
+void PackedSequence::ReverseComplement()
+{
+	size_t n = words.size();
+	if (n == 0)
+		return;
+	reverse(words.begin(), words.end());
+	for (size_t i = 0; i < n; i++)
+		words[i] = ~reverseFields(words[i]);
+	int shift = 2 * (n * BasesPerWord - length);
+	if (shift > 0)
+	{
+		for (size_t i = 0; i + 1 < n; i++)
+			words[i] = (words[i] >> shift) | (words[i + 1] << (64 - shift));
+		words[n - 1] >>= shift;
+	}
+	reverse(exceptions.begin(), exceptions.end());
+	for (size_t i = 0; i < exceptions.size(); i++)
+	{
+		Exception &e = exceptions[i];
+		e.Start = length - e.Start - e.Length;
+		e.Base = tables.Complement[(unsigned char)e.Base];
+	}
+	// neighbouring runs may have become equal (e.g. two IUPAC codes both mapping to N)
+	size_t kept = 0;
+	for (size_t i = 0; i < exceptions.size(); i++)
+	{
+		if (kept > 0 && exceptions[kept - 1].Base == exceptions[i].Base && exceptions[kept - 1].Start + exceptions[kept - 1].Length == exceptions[i].Start)
+			exceptions[kept - 1].Length += exceptions[i].Length;
+		else
+			exceptions[kept++] = exceptions[i];
+	}
+	exceptions.resize(kept, Exception(0, 0, 0));
+}
+
+size_t PackedSequence::MemoryUsage() const
+{
+	return words.capacity() * sizeof(uint64_t) + exceptions.capacity() * sizeof(Exception);
+}
@@ -0,0 +1,87 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+/*
+ * Nucleotide sequence stored with 2 bits per base. Characters other than
+ * A, C, G and T (N runs, IUPAC codes, lower case) are kept as a sorted list of
+ * runs on top of the packed bases, so unpacking restores the exact input.
+ * The packed bits under an exception run are meaningless; bits past the end
+ * of the sequence are always zero.
+ */
+
+#ifndef _PACKEDSEQUENCE_H
+#define _PACKEDSEQUENCE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+class PackedSequence
+{
+public:
+	PackedSequence() : length(0) {};
+	PackedSequence(const string &nucleotides);
+
+public:
+	void Assign(const string &nucleotides);
+	void Append(const char *nucleotides, size_t count);
+	void Clear();
+	void Reserve(size_t count);
+	size_t Length() const;
+	char At(size_t i) const;
+	void Unpack(string &nucleotides) const;
+	string Unpack() const;
+	// Complements bases the same way Sequence::ReverseCompelement does.
+	void ReverseComplement();
+	size_t MemoryUsage() const;
+
+private:
+	// A run of identical characters that cannot be packed.
+	class Exception
+	{
+	public:
+		Exception(size_t start, size_t length, char base) : Start(start), Length(length), Base(base) {};
+
+	public:
+		size_t Start;
+		size_t Length;
+		char Base;
+	};
+
+private:
+	static const int BasesPerWord = 32;
+
+private:
+	vector<uint64_t> words;
+	vector<Exception> exceptions;
+	size_t length;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "PairedAlignment.h"
+#include "Aligner.h"
+#include "Converter.h"
+#include "Helpers.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+PairedAlignment::PairedAlignment(const string &referenceFileName, const string &leftFileName, const string &rightFileName, bool isIllumina, const BWAConfiguration &bwaConfig, const NovoAlignConfiguration &novoAlignConfig, const SAMToolsConfiguration &samToolsConfig)
+	: referenceFileName(referenceFileName), isIllumina(isIllumina), novoAlignConfig(novoAlignConfig), samToolsConfig(samToolsConfig)
+{
+	left.FileName = leftFileName;
+	right.FileName = rightFileName;
+	left.BWAConfig = right.BWAConfig = bwaConfig;
+	left.BWAConfig.NumberOfThreads = max(1, (bwaConfig.NumberOfThreads + 1) / 2);
+	right.BWAConfig.NumberOfThreads = max(1, bwaConfig.NumberOfThreads / 2);
+}
+
+// Failures are reported for the left mate first, as when the mates were processed one after the other.
+PairedAlignment::PairedAlignmentResult PairedAlignment::Run()
+{
+	left.Aligned = left.Converted = right.Aligned = right.Converted = false;
+	left.BamFileName.clear();
+	right.BamFileName.clear();
+	// aligners are made here, as BWAAligner sets up shared state when constructed
+	left.Alignment = createAligner(left);
+	right.Alignment = createAligner(right);
+	thread worker(&PairedAlignment::alignAndConvert, this, &right);
+	alignAndConvert(&left);
+	worker.join();
+	deleteAligners();
+
+	PairedAlignmentResult result = Success;
+	if (!left.Aligned)
+		result = FailedLeftAlignment;
+	else if (!right.Aligned)
+		result = FailedRightAlignment;
+	else if (!left.Converted)
+		result = FailedLeftConversion;
+	else if (!right.Converted)
+		result = FailedRightConversion;
+	if (result != Success)
+	{
+		if (left.Converted)
+			Helpers::RemoveFile(left.BamFileName);
+		if (right.Converted)
+			Helpers::RemoveFile(right.BamFileName);
+		return result;
+	}
+	LeftBamFileName = left.BamFileName;
+	RightBamFileName = right.BamFileName;
+	return Success;
+}
+
+PairedAlignment::PairedAlignmentResult PairedAlignment::OpenStreams(FILE *&leftStream, FILE *&rightStream)
+{
+	left.Alignment = createAligner(left);
+	right.Alignment = createAligner(right);
+	// the references are indexed while the streams are opened, so both mates do this at once
+	thread worker(&PairedAlignment::openStream, this, &right);
+	openStream(&left);
+	worker.join();
+
+	leftStream = left.Stream;
+	rightStream = right.Stream;
+	if (leftStream != NULL && rightStream != NULL)
+		return Success;
+	PairedAlignmentResult result = (leftStream == NULL ? FailedLeftAlignment : FailedRightAlignment);
+	deleteAligners();
+	leftStream = rightStream = NULL;
+	return result;
+}
+
+PairedAlignment::PairedAlignmentResult PairedAlignment::CloseStreams()
+{
+	if (left.Alignment == NULL || right.Alignment == NULL)
+		return FailedLeftAlignment;
+	left.Aligned = left.Alignment->CloseStream();
+	right.Aligned = right.Alignment->CloseStream();
+	deleteAligners();
+	if (!left.Aligned)
+		return FailedLeftAlignment;
+	if (!right.Aligned)
+		return FailedRightAlignment;
+	return Success;
+}
+
+Aligner *PairedAlignment::createAligner(const Mate &mate) const
+{
+	return (isIllumina ? (Aligner *)new BWAAligner(referenceFileName, mate.FileName, mate.BWAConfig) : new NovoAlignAligner(referenceFileName, mate.FileName, novoAlignConfig));
+}
+
+void PairedAlignment::alignAndConvert(Mate *mate) const
+{
+	mate->Aligned = mate->Alignment->Align();
+	if (mate->Aligned)
+	{
+		Converter converter(mate->Alignment->OutputFileName, samToolsConfig);
+		mate->Converted = converter.Convert();
+		if (mate->Converted)
+		{
+			converter.RemoveOutput = false;
+			mate->BamFileName = converter.OutputFileName;
+		}
+	}
+}
+
+void PairedAlignment::openStream(Mate *mate) const
+{
+	mate->Stream = mate->Alignment->OpenStream();
+}
+
+// Deleting an aligner also closes its stream, if one is still open.
+void PairedAlignment::deleteAligners()
+{
+	delete left.Alignment;
+	delete right.Alignment;
+	left.Alignment = right.Alignment = NULL;
+	left.Stream = right.Stream = NULL;
+}
@@ -0,0 +1,91 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#ifndef _PAIREDALIGNMENT_H
+#define _PAIREDALIGNMENT_H
+
+#include "AlignerConfiguration.h"
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+class Aligner;
+
+// Aligns both mate files of a paired library to the contigs and converts the alignments
+// to BAM. The two mates are processed at once, each on a thread of its own with half of
+// the configured BWA threads, so a library takes about as long as one of its mates.
+class PairedAlignment
+{
+public:
+	enum PairedAlignmentResult { Success, FailedLeftAlignment, FailedRightAlignment, FailedLeftConversion, FailedRightConversion };
+
+public:
+	PairedAlignment(const string &referenceFileName, const string &leftFileName, const string &rightFileName, bool isIllumina, const BWAConfiguration &bwaConfig, const NovoAlignConfiguration &novoAlignConfig, const SAMToolsConfiguration &samToolsConfig);
+
+public:
+	// On success the BAM files are left for the caller to remove; on failure none are left.
+	PairedAlignmentResult Run();
+	// Starts both aligners with their SAM output going to pipes, to be read in lockstep while
+	// the mates are aligned. Nothing is converted, so only alignment failures are reported.
+	PairedAlignmentResult OpenStreams(FILE *&leftStream, FILE *&rightStream);
+	// Waits for both aligners once their output has been read and removes their files.
+	PairedAlignmentResult CloseStreams();
+
+public:
+	string LeftBamFileName;
+	string RightBamFileName;
+
+private:
+	class Mate
+	{
+	public:
+		Mate() : Alignment(NULL), Aligned(false), Converted(false), Stream(NULL) {};
+
+	public:
+		string FileName;
+		BWAConfiguration BWAConfig;
+		Aligner *Alignment;
+		bool Aligned, Converted;
+		string BamFileName;
+		FILE *Stream;
+	};
+
+private:
+	Aligner *createAligner(const Mate &mate) const;
+	void alignAndConvert(Mate *mate) const;
+	void openStream(Mate *mate) const;
+	void deleteAligners();
+
+private:
+	string referenceFileName;
+	bool isIllumina;
+	NovoAlignConfiguration novoAlignConfig;
+	SAMToolsConfiguration samToolsConfig;
+	Mate left, right;
+};
+#endif
@@ -0,0 +1,344 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "ParallelReader.h"
+#include <cstring>
+#include <cctype>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// Amount of input read for a single chunk
+#define ParallelChunkSize (4 << 20)
+
+// Converts lower case letters to upper case, 16 bytes at a time where SSE2 is available.
+static void toUpper(char *s, size_t n)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i before = _mm_set1_epi8('a' - 1), after = _mm_set1_epi8('z' + 1), flip = _mm_set1_epi8(0x20);
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, before), _mm_cmplt_epi8(v, after));
+		_mm_storeu_si128((__m128i *)(s + i), _mm_xor_si128(v, _mm_and_si128(lower, flip)));
+	}
+#endif
+	for (; i < n; i++)
+		s[i] = toupper(s[i]);
+}
+
+ParallelFastQReader::ParallelFastQReader()
+	: in(NULL), ordered(true), threads(1), maxPending(0), finished(false), stopping(false), failed(false)
+{
+}
+
+ParallelFastQReader::~ParallelFastQReader()
+{
+	Close();
+}
+
+bool ParallelFastQReader::Open(const string &filename, int threads, bool ordered)
+{
+	if (in != NULL)
+		return false;
+	in = InputStream::Open(filename);
+	if (in == NULL)
+		return false;
+	this->ordered = ordered;
+	this->threads = (threads > 0 ? threads : 1);
+	maxPending = 2 * this->threads + 2;
+	carry.clear();
+	finished = stopping = failed = false;
+	reader = thread(&ParallelFastQReader::readerLoop, this);
+	for (int i = 0; i < this->threads; i++)
+		workers.push_back(thread(&ParallelFastQReader::workerLoop, this));
+	return true;
+}
+
+bool ParallelFastQReader::Close()
+{
+	if (in == NULL)
+		return false;
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	reader.join();
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); it++)
+		it->join();
+	workers.clear();
+	for (deque<Chunk *>::iterator it = pending.begin(); it != pending.end(); it++)
+		delete *it;
+	for (vector<Chunk *>::iterator it = spare.begin(); it != spare.end(); it++)
+		delete *it;
+	pending.clear();
+	jobs.clear();
+	spare.clear();
+	delete in;
+	in = NULL;
+	return true;
+}
+
+bool ParallelFastQReader::IsOpen() const
+{
+	return in != NULL;
+}
+
+bool ParallelFastQReader::Failed() const
+{
+	return failed;
+}
+
+long long ParallelFastQReader::Read(RecordBatch &batch)
+{
+	batch.Clear();
+	if (in == NULL || failed)
+		return 0;
+	while (true)
+	{
+		Chunk *chunk = NULL;
+		{
+			unique_lock<mutex> guard(lock);
+			while (true)
+			{
+				if (ordered && !pending.empty() && pending.front()->Done)
+					chunk = pending.front();
+				for (deque<Chunk *>::iterator it = pending.begin(); !ordered && chunk == NULL && it != pending.end(); it++)
+					if ((*it)->Done)
+						chunk = *it;
+				if (chunk != NULL || (pending.empty() && finished))
+					break;
+				changed.wait(guard);
+			}
+			if (chunk == NULL)
+				return 0;
+			for (deque<Chunk *>::iterator it = pending.begin(); it != pending.end(); it++)
+				if (*it == chunk)
+				{
+					pending.erase(it);
+					break;
+				}
+			if (chunk->Failed)
+			{
+				failed = true;
+				finished = true;
+				spare.push_back(chunk);
+				changed.notify_all();
+				return 0;
+			}
+		}
+		// hand the parsed records over and keep the caller's buffers for a later chunk
+		size_t capacity = batch.Capacity();
+		batch.Swap(chunk->Records);
+		batch.SetCapacity(capacity);
+		unique_lock<mutex> guard(lock);
+		spare.push_back(chunk);
+		changed.notify_all();
+		if (batch.Size() > 0)
+			return batch.Size();
+	}
+}
+
+void ParallelFastQReader::readerLoop()
+{
+	while (true)
+	{
+		Chunk *chunk;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!stopping && pending.size() >= maxPending)
+				changed.wait(guard);
+			if (stopping)
+				return;
+			if (!spare.empty())
+			{
+				chunk = spare.back();
+				spare.pop_back();
+			}
+			else
+				chunk = new Chunk();
+		}
+		chunk->Done = chunk->Failed = false;
+		chunk->Records.Clear();
+		bool read = nextChunk(*chunk);
+		unique_lock<mutex> guard(lock);
+		if (!read)
+		{
+			spare.push_back(chunk);
+			finished = true;
+			changed.notify_all();
+			return;
+		}
+		pending.push_back(chunk);
+		changed.notify_all();
+		if (chunk->Failed)
+		{
+			// the consumer stops at this chunk
+			chunk->Done = true;
+			finished = true;
+			return;
+		}
+		jobs.push_back(chunk);
+	}
+}
+
+void ParallelFastQReader::workerLoop()
+{
+	string seq, quality;
+	while (true)
+	{
+		Chunk *chunk;
+		{
+			unique_lock<mutex> guard(lock);
+			while (!stopping && jobs.empty())
+				changed.wait(guard);
+			if (stopping)
+				return;
+			chunk = jobs.front();
+			jobs.pop_front();
+		}
+		bool parsed = parse(*chunk, seq, quality);
+		unique_lock<mutex> guard(lock);
+		chunk->Failed = !parsed;
+		chunk->Done = true;
+		changed.notify_all();
+	}
+}
+
+// Reads the next piece of input and cuts it after the last complete record;
+// the remainder is carried over to the next chunk. Returns false at the end of the input.
+bool ParallelFastQReader::nextChunk(Chunk &chunk)
+{
+	chunk.Data.swap(carry);
+	carry.clear();
+	while (true)
+	{
+		size_t size = chunk.Data.size();
+		chunk.Data.resize(size + ParallelChunkSize);
+		long long read = in->Read(&chunk.Data[size], ParallelChunkSize);
+		if (read < 0)
+		{
+			chunk.Data.clear();
+			chunk.Failed = true;
+			return true;
+		}
+		chunk.Data.resize(size + read);
+		if (read == 0)
+			return !chunk.Data.empty();
+		size_t cut = lastRecordStart(&chunk.Data[0], chunk.Data.size());
+		if (cut > 0)
+		{
+			carry.assign(chunk.Data.begin() + cut, chunk.Data.end());
+			chunk.Data.resize(cut);
+			return true;
+		}
+		// a single record larger than the chunk: keep reading
+	}
+}
+
+// Returns the offset of the last line that certainly starts a record, or 0 if
+// there is none after the first line. A quality line may start with '@' as
+// well, but is never followed two lines later by a '+' line.
+size_t ParallelFastQReader::lastRecordStart(const char *data, size_t size)
+{
+	// starts of the last lines, most recent first
+	size_t starts[3];
+	int known = 0;
+	size_t end = size;
+	while (end > 0)
+	{
+		const char *nl = (const char *)memrchr(data, '\n', end - 1);
+		size_t start = (nl == NULL ? 0 : nl - data + 1);
+		if (start > 0 && start < size && known >= 2 && data[start] == '@' && data[starts[1]] == '+')
+			return start;
+		if (start == 0)
+			break;
+		starts[2] = starts[1];
+		starts[1] = starts[0];
+		starts[0] = start;
+		if (known < 3)
+			known++;
+		end = start;
+	}
+	return 0;
+}
+
+// Parses a chunk that starts on a record boundary, with the same trimming and
+// case conversion as FastQReader.
+bool ParallelFastQReader::parse(Chunk &chunk, string &seq, string &quality)
+{
+	const char *p = chunk.Data.empty() ? NULL : &chunk.Data[0];
+	const char *end = p + chunk.Data.size();
+	while (p < end)
+	{
+		if (*p != '@')
+			return false;
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		if (eol == NULL)
+			eol = end;
+		const char *comment = p + 1;
+		int commentLength = eol - comment;
+		p = (eol < end ? eol + 1 : end);
+		seq.clear();
+		quality.clear();
+		while (p < end)
+		{
+			eol = (const char *)memchr(p, '\n', end - p);
+			if (eol == NULL)
+				eol = end;
+			const char *line = p;
+			p = (eol < end ? eol + 1 : end);
+			if (*line == '+')
+			{
+				if (p >= end)
+					break;
+				eol = (const char *)memchr(p, '\n', end - p);
+				if (eol == NULL)
+					eol = end;
+				const char *last = eol;
+				while (last > p && isspace(last[-1]))
+					--last;
+				quality.assign(p, last - p);
+				p = (eol < end ? eol + 1 : end);
+				break;
+			}
+			const char *last = eol;
+			while (last > line && isspace(last[-1]))
+				--last;
+			seq.append(line, last - line);
+		}
+		if (!seq.empty())
+			toUpper(&seq[0], seq.length());
+		chunk.Records.Add(comment, commentLength, seq.data(), seq.length(), quality.data(), quality.length());
+	}
+	chunk.Data.clear();
+	return true;
+}
@@ -0,0 +1,109 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+/*
+ * FastQ reader that parses on several threads. A reader thread cuts the input
+ * into chunks that end on a record boundary, worker threads parse whole chunks
+ * into RecordBatch blocks and the consumer receives the batches either in
+ * input order or, when allowed, in the order they are finished.
+ */
+
+#ifndef _PARALLELREADER_H
+#define _PARALLELREADER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Sequence.h"
+#include "InputStream.h"
+
+using namespace std;
+
+// Chunk boundaries are found by looking for a line starting with '@' that is
+// followed two lines later by a line starting with '+', so records are
+// expected in the usual four line layout. Use FastQReader for FastQ files
+// with wrapped sequences.
+class ParallelFastQReader
+{
+public:
+	ParallelFastQReader();
+	~ParallelFastQReader();
+
+public:
+	// Opens a file ("-" for standard input). Batches are returned in input order unless ordered is false.
+	bool Open(const string &filename, int threads = InputStream::Threads, bool ordered = true);
+	bool Close();
+	bool IsOpen() const;
+	// Replaces the contents of batch with the records of the next chunk, whatever the capacity of the batch.
+	// Returns the number of records, 0 at the end of the input or after an error.
+	long long Read(RecordBatch &batch);
+	// Returns true if reading stopped because of a read error or a malformed record.
+	bool Failed() const;
+
+private:
+	class Chunk
+	{
+	public:
+		Chunk() : Done(false), Failed(false) {};
+
+	public:
+		vector<char> Data;
+		RecordBatch Records;
+		bool Done;
+		bool Failed;
+	};
+
+private:
+	void readerLoop();
+	void workerLoop();
+	bool nextChunk(Chunk &chunk);
+	static size_t lastRecordStart(const char *data, size_t size);
+	static bool parse(Chunk &chunk, string &seq, string &quality);
+
+private:
+	InputStream *in;
+	vector<char> carry;
+	bool ordered;
+	int threads;
+	size_t maxPending;
+	thread reader;
+	vector<thread> workers;
+	mutex lock;
+	condition_variable changed;
+	deque<Chunk *> pending;
+	deque<Chunk *> jobs;
+	vector<Chunk *> spare;
+	bool finished;
+	bool stopping;
+	bool failed;
+};
+
+#endif
@@ -42,7 +42,7 @@ vector<int> ReadCoverageRepeatDetecter::Detect(double expectedCoverage, const Re
     for (int i = 0; i < nContigs; i++)
     {
         double observedMean = 0.0;
-        int contigLength = store[i].Sequence.Nucleotides.length();
+        int contigLength = store[i].Length();
         vector<int> readPositions(coverage.ReadLocations[i]);
         sort(readPositions.begin(), readPositions.end());
         vector<int>::const_iterator pos = readPositions.begin();
@@ -29,15 +29,30 @@
 #include "Reader.h"
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+// Size of the read-ahead buffer between the input stream and the line parser
+#define ChunkSize (1 << 20)
+
 Reader::Reader()
 {
     fin = NULL;
     line = new char[MaxLine];
     buf = new char[MaxLine];
+    chunk = new char[ChunkSize];
+    pending = new char[MaxLine];
+    chunkPos = chunkLen = pendingLen = 0;
+    offset = 0;
+    pushedBack = false;
     num_reads = -1;
 }
 
@@ -45,9 +60,12 @@ bool Reader::Open(const string &filename, const string &mode)
 {
     if (fin != NULL)
         return false;
-    fin = fopen(filename.c_str(), mode.c_str());
+    fin = InputStream::Open(filename, mode);
     if (fin == NULL)
         return false;
+    chunkPos = chunkLen = 0;
+    offset = 0;
+    pushedBack = false;
     return true;
 }
 
@@ -55,7 +73,7 @@ bool Reader::Close()
 {
     if (fin != NULL)
     {
-        fclose(fin);
+        delete fin;
         fin = NULL;
         num_reads = -1;
         return true;
@@ -68,16 +86,112 @@ bool Reader::IsOpen() const
 	return fin != NULL;
 }
 
+// Streams that cannot be rewound (pipes, standard input) can only be read once.
+bool Reader::CanRewind() const
+{
+    return fin != NULL && fin->CanRewind();
+}
+
+bool Reader::Rewind()
+{
+    if (fin == NULL || !fin->Rewind())
+        return false;
+    chunkPos = chunkLen = 0;
+    offset = 0;
+    pushedBack = false;
+    return true;
+}
+
 Reader::~Reader()
 {
     Close();
     delete [] line;
     delete [] buf;
+    delete [] chunk;
+    delete [] pending;
+}
+
+bool Reader::fill()
+{
+    long long read = fin->Read(chunk, ChunkSize);
+    if (read < 0)
+        throw runtime_error("Reader : unable to read input stream.");
+    chunkPos = 0;
+    chunkLen = (int)read;
+    return chunkLen > 0;
+}
+
+// Reads a line into str with the semantics of fgets: at most size - 1 characters
+// are stored, the newline is kept and the string is always terminated.
+bool Reader::getLine(char *str, int size)
+{
+    if (pushedBack)
+    {
+        memcpy(str, pending, pendingLen + 1);
+        offset += pendingLen;
+        pushedBack = false;
+        return true;
+    }
+    int len = 0;
+    while (len < size - 1)
+    {
+        if (chunkPos == chunkLen && !fill())
+            break;
+        int n = min(size - 1 - len, chunkLen - chunkPos);
+        const char *start = chunk + chunkPos;
+        const char *eol = (const char *)memchr(start, '\n', n);
+        if (eol != NULL)
+            n = eol - start + 1;
+        memcpy(str + len, start, n);
+        chunkPos += n;
+        len += n;
+        if (eol != NULL)
+            break;
+    }
+    str[len] = '\0';
+    offset += len;
+    if (len > 0)
+    {
+        memcpy(pending, str, len + 1);
+        pendingLen = len;
+    }
+    return len > 0;
+}
+
+// Makes the next getLine call return the last line again.
+void Reader::ungetLine()
+{
+    pushedBack = true;
+    offset -= pendingLen;
+}
+
+long long Reader::tell() const
+{
+    return offset;
+}
+
+// Moves to an absolute position in the (uncompressed) input, rewinding if needed.
+bool Reader::seek(long long position)
+{
+    if (position < offset || pushedBack)
+    {
+        if (!Rewind())
+            return false;
+    }
+    while (offset < position)
+    {
+        if (chunkPos == chunkLen && !fill())
+            return false;
+        int n = (int)min((long long)(chunkLen - chunkPos), position - offset);
+        chunkPos += n;
+        offset += n;
+    }
+    return true;
 }
 
 bool FastAReader::Read(string &seq, string &comment)
 {
-    if (fgets(line, MaxLine, fin) == NULL)
+    if (!getLine(line, MaxLine))
         return false;
 
     if (line[0] != '>')
@@ -88,11 +202,11 @@ bool FastAReader::Read(string &seq, string &comment)
 	seq.clear();
 
     int offset = 0;
-    while (fgets(line, MaxLine, fin) != NULL)
+    while (getLine(line, MaxLine))
     {
         if (line[0] == '>')
         {
-            fseek(fin, -strlen(line), SEEK_CUR);
+            ungetLine();
             break;
         }
 
@@ -128,38 +242,49 @@ bool FastAReader::Read(FastASequence &seq)
     return Read(seq.Nucleotides, seq.Comment);
 }
 
+// Reads the remaining records in a single pass, so the input does not have to be seekable.
 long long FastAReader::Read(vector<FastASequence> &sequences)
 {
-    sequences.resize(NumReads());
+    bool fromStart = tell() == 0;
+    sequences.clear();
     string seq;
     string comment;
-    for (unsigned i = 0; i < sequences.size(); ++i)
-    {
-        Read(seq, comment);
-	sequences[i] = FastASequence(seq, comment);
-    }
+    while (Read(seq, comment))
+        sequences.push_back(FastASequence(seq, comment));
 
+    if (fromStart)
+        num_reads = sequences.size();
     return sequences.size();
 }
 
+// The strings used for parsing keep their capacity between records, so a
+// batch is filled without allocating once it and the strings have grown.
+long long FastAReader::Read(RecordBatch &batch)
+{
+    batch.Clear();
+    while (!batch.Full() && Read(batchSeq, batchComment))
+        batch.Add(batchComment, batchSeq);
+    return batch.Size();
+}
+
 long long FastAReader::NumReads()
 {
     if (!IsOpen())
         return 0;
-    long long index = ftell(fin);
+    long long index = tell();
 
-    if (num_reads >= 0)
+    if (num_reads >= 0 || !CanRewind())
         return num_reads;
 
-    fseek(fin, 0, SEEK_SET);
+    Rewind();
     long long num = 0;
-    while (fgets(line, MaxLine, fin) != NULL)
+    while (getLine(line, MaxLine))
     {
         if (line[0] == '>')
             ++num;
     }
 
-    fseek(fin, index, SEEK_SET);
+    seek(index);
     return num_reads = num;
 }
 
@@ -171,7 +296,7 @@ bool FastQReader::Read(string &seq, string &comment)
 
 bool FastQReader::Read(string &seq, string &comment, string &quality)
 {
-    if (fgets(line, MaxLine, fin) == NULL)
+    if (!getLine(line, MaxLine))
         return false;
 
     if (line[0] != '@')
@@ -183,12 +308,12 @@ bool FastQReader::Read(string &seq, string &comment, string &quality)
 	quality.clear();
 
     int offset = 0;
-    while (fgets(line, MaxLine, fin) != NULL)
+    while (getLine(line, MaxLine))
     {
         if (line[0] == '+')
         {
 			// read the comment
-            fgets(line, MaxLine, fin);
+            getLine(line, MaxLine);
             line[strlen(line) - 1] = '\0';
 			// read single line (must be shorter than MaxLine) of quality scores
 			int len = strlen(line);
@@ -239,50 +364,369 @@ bool FastQReader::Read(FastQSequence &seq)
 
 long long FastQReader::Read(vector<FastASequence> &sequences)
 {
-    sequences.resize(NumReads());
+    bool fromStart = tell() == 0;
+    sequences.clear();
     string seq;
     string comment;
-    for (unsigned i = 0; i < sequences.size(); ++i)
-    {
-        Read(seq, comment);
-		sequences[i] = FastASequence(seq, comment);
-    }
+    while (Read(seq, comment))
+        sequences.push_back(FastASequence(seq, comment));
 
+    if (fromStart)
+        num_reads = sequences.size();
     return sequences.size();
 }
 
 long long FastQReader::Read(vector<FastQSequence> &sequences)
 {
-    sequences.resize(NumReads());
+    bool fromStart = tell() == 0;
+    sequences.clear();
     string seq;
     string comment;
 	string quality;
-    for (unsigned i = 0; i < sequences.size(); ++i)
-    {
-        Read(seq, comment, quality);
-		sequences[i] = FastQSequence(seq, comment, quality);
-    }
+    while (Read(seq, comment, quality))
+        sequences.push_back(FastQSequence(seq, comment, quality));
 
+    if (fromStart)
+        num_reads = sequences.size();
     return sequences.size();
 }
 
+long long FastQReader::Read(RecordBatch &batch)
+{
+    batch.Clear();
+    while (!batch.Full() && Read(batchSeq, batchComment, batchQuality))
+        batch.Add(batchComment, batchSeq, batchQuality);
+    return batch.Size();
+}
+
 long long FastQReader::NumReads()
 {
     if (!IsOpen())
         return 0;
-    long long index = ftell(fin);
+    long long index = tell();
 
-    if (num_reads >= 0)
+    if (num_reads >= 0 || !CanRewind())
         return num_reads;
 
-    fseek(fin, 0, SEEK_SET);
+    Rewind();
     long long num = 0;
-    while (fgets(line, MaxLine, fin) != NULL)
+    while (getLine(line, MaxLine))
     {
         if (line[0] == '@')
             ++num;
     }
 
-    fseek(fin, index, SEEK_SET);
+    seek(index);
+    return num_reads = num;
+}
+
+// Copies the sequence lines of a record into seq, dropping trailing whitespace
+// of every line and converting nucleotides to upper case.
+void FastARecord::GetNucleotides(string &seq) const
+{
+    seq.resize(DataLength);
+    size_t len = 0;
+    const char *p = Data, *end = Data + DataLength;
+    while (p < end)
+    {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *last = eol;
+        while (last > p && isspace(last[-1]))
+            --last;
+        memcpy(&seq[0] + len, p, last - p);
+        len += last - p;
+        p = eol + 1;
+    }
+    seq.resize(len);
+    for (size_t i = 0; i < len; ++i)
+        seq[i] = toupper(seq[i]);
+}
+
+// Packs the sequence lines of a record directly, without building the unpacked string.
+void FastARecord::GetNucleotides(PackedSequence &seq) const
+{
+    char upper[MaxLine];
+    seq.Clear();
+    seq.Reserve(DataLength);
+    const char *p = Data, *end = Data + DataLength;
+    while (p < end)
+    {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *last = eol;
+        while (last > p && isspace(last[-1]))
+            --last;
+        while (p < last)
+        {
+            int n = min((long)(last - p), (long)MaxLine);
+            for (int i = 0; i < n; i++)
+                upper[i] = toupper(p[i]);
+            seq.Append(upper, n);
+            p += n;
+        }
+        p = eol + 1;
+    }
+}
+
+string FastARecord::Nucleotides() const
+{
+    string seq;
+    GetNucleotides(seq);
+    return seq;
+}
+
+string FastARecord::Comment() const
+{
+    return string(Header, HeaderLength);
+}
+
+long long FastARecord::Length() const
+{
+    long long len = 0;
+    const char *p = Data, *end = Data + DataLength;
+    while (p < end)
+    {
+        const char *eol = (const char *)memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *last = eol;
+        while (last > p && isspace(last[-1]))
+            --last;
+        len += last - p;
+        p = eol + 1;
+    }
+    return len;
+}
+
+MappedFastAReader::MappedFastAReader()
+{
+    fd = -1;
+    data = NULL;
+    opened = owned = false;
+    size = pos = 0;
+    num_reads = -1;
+}
+
+MappedFastAReader::~MappedFastAReader()
+{
+    Close();
+}
+
+bool MappedFastAReader::Open(const string &filename)
+{
+    if (opened)
+        return false;
+    struct stat s;
+    if (filename == "-" || (stat(filename.c_str(), &s) == 0 && !S_ISREG(s.st_mode)))
+        return loadInput(filename);
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    opened = true;
+    if (fstat(fd, &s) != 0 || !S_ISREG(s.st_mode))
+    {
+        Close();
+        return false;
+    }
+    size = s.st_size;
+    pos = 0;
+    if (size == 0)
+        return true;
+    unsigned char magic[2];
+    if (size >= 2 && pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return loadInput(filename);
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    data = (const char *)map;
+    return true;
+}
+
+bool MappedFastAReader::Close()
+{
+    if (!opened)
+        return false;
+    if (data != NULL && owned)
+        free((void *)data);
+    else if (data != NULL)
+        munmap((void *)data, size);
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+    data = NULL;
+    opened = owned = false;
+    size = pos = 0;
+    num_reads = -1;
+    return true;
+}
+
+// Compressed input, pipes and standard input cannot be mapped, so they are
+// read into memory once and served through the same record views.
+bool MappedFastAReader::loadInput(const string &filename)
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    opened = true;
+    InputStream *in = InputStream::Open(filename);
+    if (in == NULL)
+    {
+        Close();
+        return false;
+    }
+    size_t capacity = 1 << 20, length = 0;
+    char *buffer = (char *)malloc(capacity);
+    long long read = 0;
+    while (buffer != NULL && (read = in->Read(buffer + length, capacity - length)) > 0)
+    {
+        length += read;
+        if (length == capacity)
+        {
+            char *grown = (char *)realloc(buffer, capacity *= 2);
+            if (grown == NULL)
+                free(buffer);
+            buffer = grown;
+        }
+    }
+    delete in;
+    if (buffer == NULL || read < 0)
+    {
+        free(buffer);
+        Close();
+        return false;
+    }
+    data = buffer;
+    size = length;
+    pos = 0;
+    owned = true;
+    return true;
+}
+
+bool MappedFastAReader::IsOpen() const
+{
+    return opened;
+}
+
+bool MappedFastAReader::IsMapped() const
+{
+    return opened && !owned;
+}
+
+long long MappedFastAReader::Offset(const char *p) const
+{
+    return p - data;
+}
+
+// Returns the record starting at the current position and advances past it.
+// The next record starts at the first '>' that begins a line.
+bool MappedFastAReader::Next(FastARecord &record)
+{
+    if (pos >= size)
+        return false;
+    const char *end = data + size;
+    const char *p = data + pos;
+    if (*p != '>')
+        throw runtime_error("MappedFastAReader : comment is not in correct format.");
+
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    if (eol == NULL)
+        eol = end;
+    record.Header = p + 1;
+    record.HeaderLength = eol - p - 1;
+    if (record.HeaderLength > 0 && record.Header[record.HeaderLength - 1] == '\r')
+        record.HeaderLength--;
+
+    const char *start = (eol < end ? eol + 1 : end);
+    const char *next = start;
+    while (next < end)
+    {
+        next = (const char *)memchr(next, '>', end - next);
+        if (next == NULL)
+        {
+            next = end;
+            break;
+        }
+        if (next[-1] == '\n')
+            break;
+        ++next;
+    }
+    record.Data = start;
+    record.DataLength = next - start;
+    pos = next - data;
+    return true;
+}
+
+bool MappedFastAReader::Read(string &seq, string &comment)
+{
+    FastARecord record;
+    if (!Next(record))
+        return false;
+    comment.assign(record.Header, record.HeaderLength);
+    record.GetNucleotides(seq);
+    return true;
+}
+
+bool MappedFastAReader::Read(FastASequence &seq)
+{
+    return Read(seq.Nucleotides, seq.Comment);
+}
+
+long long MappedFastAReader::Read(vector<FastASequence> &sequences)
+{
+    FastARecord record;
+    bool fromStart = pos == 0;
+    long long num = 0;
+    sequences.clear();
+    while (Next(record))
+    {
+        sequences.push_back(FastASequence());
+        sequences.back().Comment.assign(record.Header, record.HeaderLength);
+        record.GetNucleotides(sequences.back().Nucleotides);
+        ++num;
+    }
+    if (fromStart)
+        num_reads = num;
+    return num;
+}
+
+long long MappedFastAReader::Read(vector<FastARecord> &records)
+{
+    FastARecord record;
+    bool fromStart = pos == 0;
+    records.clear();
+    while (Next(record))
+        records.push_back(record);
+    if (fromStart)
+        num_reads = records.size();
+    return records.size();
+}
+
+// Counts records by looking for '>' at the start of a line; no data is copied.
+long long MappedFastAReader::NumReads()
+{
+    if (!IsOpen())
+        return 0;
+    if (num_reads >= 0)
+        return num_reads;
+
+    long long num = 0;
+    const char *p = data, *end = data + size;
+    if (size > 0 && *p == '>')
+        ++num, ++p;
+    while (p < end && (p = (const char *)memchr(p, '>', end - p)) != NULL)
+    {
+        if (p[-1] == '\n')
+            ++num;
+        ++p;
+    }
     return num_reads = num;
 }
@@ -38,6 +38,8 @@
 #include <string>
 #include <vector>
 #include "Sequence.h"
+#include "InputStream.h"
+#include "PackedSequence.h"
 
 using namespace std;
 
@@ -49,18 +51,41 @@ public:
 
     virtual bool Read(FastASequence &seq) = 0;
     virtual bool Read(string &seq, string &comment) = 0;
+    // Returns -1 for streams that cannot be rewound until they have been read completely.
     virtual long long NumReads() = 0;
     virtual long long Read(vector<FastASequence> &sequences) = 0;
+    // Replaces the contents of batch with up to batch.Capacity() records. Returns the number of records read.
+    virtual long long Read(RecordBatch &batch) = 0;
+    // Opens a file, or standard input when filename is "-".
     bool Open(const string &filename, const string &mode = "rb");
     bool Close();
     bool IsOpen() const;
-    void Rewind() { fseek(fin, 0, SEEK_SET); }
+    bool CanRewind() const;
+    bool Rewind();
+
+protected:
+    bool getLine(char *str, int size);
+    void ungetLine();
+    long long tell() const;
+    bool seek(long long position);
 
 protected:
     long long num_reads;
-    FILE *fin;
+    InputStream *fin;
     char *line;
     char *buf;
+
+private:
+    bool fill();
+
+private:
+    char *chunk;
+    int chunkPos;
+    int chunkLen;
+    long long offset;
+    char *pending;
+    int pendingLen;
+    bool pushedBack;
 };
 
 class FastAReader: public Reader
@@ -72,7 +97,12 @@ public:
     bool Read(string &seq, string &comment);
     bool Read(FastASequence &seq);
     long long Read(vector<FastASequence> &sequences);
+    long long Read(RecordBatch &batch);
     long long NumReads();
+
+private:
+    string batchSeq;
+    string batchComment;
 };
 
 class FastQReader: public Reader
@@ -87,7 +117,72 @@ public:
 	bool Read(FastQSequence &seq);
 	long long Read(vector<FastASequence> &sequences);
 	long long Read(vector<FastQSequence> &sequences);
+	long long Read(RecordBatch &batch);
+    long long NumReads();
+
+private:
+    string batchSeq;
+    string batchComment;
+    string batchQuality;
+};
+
+// A view of a single FastA record inside a memory mapped file. Header and
+// Data point into the mapping and stay valid until the reader is closed.
+class FastARecord
+{
+public:
+    FastARecord() : Header(NULL), HeaderLength(0), Data(NULL), DataLength(0) {}
+
+    string Comment() const;
+    string Nucleotides() const;
+    void GetNucleotides(string &seq) const;
+    void GetNucleotides(PackedSequence &seq) const;
+    long long Length() const;
+
+public:
+    const char *Header;
+    size_t HeaderLength;
+    const char *Data;
+    size_t DataLength;
+};
+
+// FastA reader working on a read-only memory mapping of the input file.
+// Records are returned as views; owned strings are only built on request.
+// Compressed files, pipes and standard input ("-") are read into memory
+// instead of being mapped.
+class MappedFastAReader
+{
+public:
+    MappedFastAReader();
+    virtual ~MappedFastAReader();
+
+    bool Open(const string &filename);
+    bool Close();
+    bool IsOpen() const;
+    void Rewind() { pos = 0; }
+    // True if the records point into a mapping of the file rather than a copy in memory.
+    bool IsMapped() const;
+    // Byte offset in the file of a pointer into a record.
+    long long Offset(const char *p) const;
+
+    bool Next(FastARecord &record);
+    bool Read(string &seq, string &comment);
+    bool Read(FastASequence &seq);
+    long long Read(vector<FastASequence> &sequences);
+    long long Read(vector<FastARecord> &records);
     long long NumReads();
+
+private:
+    bool loadInput(const string &filename);
+
+private:
+    int fd;
+    bool opened;
+    bool owned;
+    const char *data;
+    size_t size;
+    size_t pos;
+    long long num_reads;
 };
 
 #endif
@@ -57,37 +57,25 @@ void Sequence::ReverseCompelement()
 	complement();
 }
 
+// Complement of every character: A/C/G/T in both cases are swapped, N, n and *
+// are kept and everything else becomes N.
+static const char *complementTable()
+{
+	static char table[256];
+	for (int c = 0; c < 256; c++)
+		table[c] = 'N';
+	const char *from = "ATCGatcgNn*", *to = "TAGCtagcNn*";
+	for (int i = 0; from[i]; i++)
+		table[(unsigned char)from[i]] = to[i];
+	return table;
+}
+
 void Sequence::complement()
 {
+	static const char *table = complementTable();
 	int n = Nucleotides.length();
 	for (int i = 0; i < n; i++)
-		switch (Nucleotides[i])
-		{
-			case 'A' : Nucleotides[i] = 'T';
-				break;
-			case 'T' : Nucleotides[i] = 'A';
-				break;
-			case 'C' : Nucleotides[i] = 'G';
-				break;
-			case 'G' : Nucleotides[i] = 'C';
-				break;
-			case 'a' : Nucleotides[i] = 't';
-				break;
-			case 't' : Nucleotides[i] = 'a';
-				break;
-			case 'c' : Nucleotides[i] = 'g';
-				break;
-			case 'g' : Nucleotides[i] = 'c';
-				break;
-			case 'N' : Nucleotides[i] = 'N';
-				break;
-			case 'n' : Nucleotides[i] = 'n';
-				break;
-			case '*' : Nucleotides[i] = '*';
-				break;
-			default :
-				Nucleotides[i] = 'N';
-		}
+		Nucleotides[i] = table[(unsigned char)Nucleotides[i]];
 }
 
 FastASequence::FastASequence(const BamAlignment &alg)
@@ -108,3 +96,100 @@ void FastQSequence::ReverseCompelement()
 	complement();
 	reverse(Quality.begin(), Quality.end());
 }
+
+void RecordBatch::Clear()
+{
+	data.clear();
+	entries.clear();
+}
+
+size_t RecordBatch::Size() const
+{
+	return entries.size();
+}
+
+size_t RecordBatch::Capacity() const
+{
+	return capacity;
+}
+
+void RecordBatch::SetCapacity(size_t capacity)
+{
+	this->capacity = capacity;
+}
+
+bool RecordBatch::Full() const
+{
+	return entries.size() >= capacity;
+}
+
+void RecordBatch::Add(const string &comment, const string &nucleotides, const string &quality)
+{
+	Add(comment.data(), comment.length(), nucleotides.data(), nucleotides.length(), quality.data(), quality.length());
+}
+
+void RecordBatch::Add(const char *comment, int commentLength, const char *nucleotides, int length, const char *quality, int qualityLength)
+{
+	size_t offset = data.size();
+	data.insert(data.end(), comment, comment + commentLength);
+	data.push_back('\0');
+	data.insert(data.end(), nucleotides, nucleotides + length);
+	data.push_back('\0');
+	data.insert(data.end(), quality, quality + qualityLength);
+	data.push_back('\0');
+	entries.push_back(Entry(offset, commentLength, length, qualityLength));
+}
+
+void RecordBatch::Swap(RecordBatch &other)
+{
+	data.swap(other.data);
+	entries.swap(other.entries);
+	swap(capacity, other.capacity);
+}
+
+const char *RecordBatch::Comment(size_t i) const
+{
+	return &data[entries[i].Offset];
+}
+
+const char *RecordBatch::Nucleotides(size_t i) const
+{
+	return &data[entries[i].Offset + entries[i].CommentLength + 1];
+}
+
+const char *RecordBatch::Quality(size_t i) const
+{
+	return &data[entries[i].Offset + entries[i].CommentLength + entries[i].Length + 2];
+}
+
+int RecordBatch::CommentLength(size_t i) const
+{
+	return entries[i].CommentLength;
+}
+
+int RecordBatch::Length(size_t i) const
+{
+	return entries[i].Length;
+}
+
+int RecordBatch::QualityLength(size_t i) const
+{
+	return entries[i].QualityLength;
+}
+
+void RecordBatch::Get(size_t i, FastASequence &seq) const
+{
+	seq.Comment.assign(Comment(i), CommentLength(i));
+	seq.Nucleotides.assign(Nucleotides(i), Length(i));
+}
+
+void RecordBatch::Get(size_t i, FastQSequence &seq) const
+{
+	Get(i, (FastASequence &)seq);
+	seq.Quality.assign(Quality(i), QualityLength(i));
+}
+
+size_t RecordBatch::MemoryUsage() const
+{
+	return data.capacity() + entries.capacity() * sizeof(Entry);
+}
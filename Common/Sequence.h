@@ -29,7 +29,9 @@
 #ifndef _SEQUENCE_H
 #define _SEQUENCE_H
 
+#include <cstddef>
 #include <string>
+#include <vector>
 #include "api/BamAlignment.h"
 
 using namespace std;
@@ -79,4 +81,51 @@ public:
 	string Quality;
 };
 
+// A reusable block of records sharing a single character buffer. Each record
+// is stored as comment, nucleotides and quality (empty for FastA), each zero
+// terminated, and addressed by offset, so refilling a batch does not allocate
+// once the buffer has grown. Pointers stay valid until the batch is changed.
+class RecordBatch
+{
+public:
+	RecordBatch(size_t capacity = 65536) : capacity(capacity) {};
+
+public:
+	void Clear();
+	size_t Size() const;
+	size_t Capacity() const;
+	void SetCapacity(size_t capacity);
+	bool Full() const;
+	void Add(const string &comment, const string &nucleotides, const string &quality = string());
+	void Add(const char *comment, int commentLength, const char *nucleotides, int length, const char *quality, int qualityLength);
+	void Swap(RecordBatch &other);
+	const char *Comment(size_t i) const;
+	const char *Nucleotides(size_t i) const;
+	const char *Quality(size_t i) const;
+	int CommentLength(size_t i) const;
+	int Length(size_t i) const;
+	int QualityLength(size_t i) const;
+	void Get(size_t i, FastASequence &seq) const;
+	void Get(size_t i, FastQSequence &seq) const;
+	size_t MemoryUsage() const;
+
+private:
+	class Entry
+	{
+	public:
+		Entry(size_t offset, int commentLength, int length, int qualityLength) : Offset(offset), CommentLength(commentLength), Length(length), QualityLength(qualityLength) {};
+
+	public:
+		size_t Offset;
+		int CommentLength;
+		int Length;
+		int QualityLength;
+	};
+
+private:
+	vector<char> data;
+	vector<Entry> entries;
+	size_t capacity;
+};
+
 #endif
@@ -27,22 +27,24 @@
 
 #include "Writer.h"
 #include "Globals.h"
-#include "MinMax.h"
 #include <string>
 #include <cstring>
+#include <algorithm>
 
 using namespace std;
 
+// Amount of text collected before it is passed to the output stream
+#define WriteBufferSize (1 << 20)
+
 Writer::Writer()
 {
     fout = NULL;
-	buf = new char[MaxLine];
+	failed = false;
 }
 
 Writer::~Writer()
 {
     Close();
-	delete [] buf;
 }
 
 bool Writer::Open(const string &filename, const string &mode)
@@ -50,34 +52,70 @@ bool Writer::Open(const string &filename, const string &mode)
 	if (fout != NULL)
 		return false;
 
-	fout = fopen(filename.c_str(), mode.c_str());
+	fout = OutputStream::Open(filename, mode, OutputStream::IsCompressedName(filename));
     if (fout == NULL)
 		return false;
+	buffer.clear();
+	buffer.reserve(WriteBufferSize);
+	failed = false;
 	return true;
 }
 
+// Returns false if any of the buffered output could not be written.
 bool Writer::Close()
 {
 	if (fout != NULL)
 	{
-        fclose(fout);
+		flush();
+		if (!fout->Close())
+			failed = true;
+		delete fout;
 		fout = NULL;
-		return true;
+		string().swap(buffer);
+		return !failed;
 	}
 	return false;
 }
 
+bool Writer::flush()
+{
+	if (!buffer.empty() && !fout->Write(buffer.data(), buffer.size()))
+		failed = true;
+	buffer.clear();
+	return !failed;
+}
+
+void Writer::put(const char *data, size_t size)
+{
+	buffer.append(data, size);
+	if (buffer.size() >= WriteBufferSize)
+		flush();
+}
+
+void Writer::put(const string &str)
+{
+	put(str.data(), str.length());
+}
+
+void Writer::put(char c)
+{
+	buffer.push_back(c);
+}
+
 void Writer::splitPrint(const string &seq, int num)
 {
-	int len = seq.length();
+	splitPrint(seq.data(), seq.length(), num);
+}
+
+void Writer::splitPrint(const char *seq, int len, int num)
+{
 	if (num > MaxLine - 1)
 		num = MaxLine - 1;
 	for (int i = 0; i < len; i += num)
 	{
 		int left = min(num, len - i);
-		memcpy(buf, seq.c_str() + i, left);
-		buf[left] = '\0';
-		fprintf(fout, "%s\n", buf);
+		put(seq + i, left);
+		put('\n');
 	}
 }
 
@@ -86,11 +124,12 @@ bool FastAWriter::Write(const string &seq, const string &comment)
 	if (fout == NULL)
 		return false;
 
-    fprintf(fout, ">%s\n", comment.c_str());
-    //fprintf(fout, "%s\n", seq.c_str());
+	put('>');
+	put(comment);
+	put('\n');
     splitPrint(seq);
 
-    return true;
+    return !failed;
 }
 
 bool FastAWriter::Write(const FastASequence &seq)
@@ -108,6 +147,27 @@ bool FastAWriter::Write(const vector<FastASequence> &seq)
 	return true;
 }
 
+bool FastAWriter::Write(const RecordBatch &batch, size_t i)
+{
+	if (fout == NULL)
+		return false;
+
+	put('>');
+	put(batch.Comment(i), batch.CommentLength(i));
+	put('\n');
+	splitPrint(batch.Nucleotides(i), batch.Length(i), 80);
+
+	return !failed;
+}
+
+bool FastAWriter::Write(const RecordBatch &batch)
+{
+	for (size_t i = 0; i < batch.Size(); i++)
+		if (!Write(batch, i))
+			return false;
+	return true;
+}
+
 bool FastQWriter::Write(const string &seq, const string &comment)
 {
     string quality;
@@ -119,16 +179,21 @@ bool FastQWriter::Write(const string &seq, const string &comment)
 
 bool FastQWriter::Write(const string &seq, const string &comment, const string &quality)
 {
-    if (fout == NULL)
-        return false;
-    
-    fprintf(fout, "@%s\n", comment.c_str());
-    fprintf(fout, "%s\n", seq.c_str());
-    //splitPrint(seq);
-    fprintf(fout, "+%s\n", comment.c_str());
-    fprintf(fout, "%s\n", quality.c_str());
+	if (fout == NULL)
+		return false;
 
-    return true;
+	put('@');
+	put(comment);
+	put('\n');
+	put(seq);
+	put('\n');
+	put('+');
+	put(comment);
+	put('\n');
+	put(quality);
+	put('\n');
+
+	return !failed;
 }
 
 bool FastQWriter::Write(const FastASequence &seq)
@@ -158,3 +223,33 @@ bool FastQWriter::Write(const vector<FastQSequence> &seq)
 			return false;
 	return true;
 }
+
+bool FastQWriter::Write(const RecordBatch &batch, size_t i)
+{
+	if (fout == NULL)
+		return false;
+
+	put('@');
+	put(batch.Comment(i), batch.CommentLength(i));
+	put('\n');
+	put(batch.Nucleotides(i), batch.Length(i));
+	put('\n');
+	put('+');
+	put(batch.Comment(i), batch.CommentLength(i));
+	put('\n');
+	if (batch.QualityLength(i) == 0)
+		put(string(batch.Length(i), 'a'));
+	else
+		put(batch.Quality(i), batch.QualityLength(i));
+	put('\n');
+
+	return !failed;
+}
+
+bool FastQWriter::Write(const RecordBatch &batch)
+{
+	for (size_t i = 0; i < batch.Size(); i++)
+		if (!Write(batch, i))
+			return false;
+	return true;
+}
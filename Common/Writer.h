@@ -33,9 +33,12 @@
 #include <string>
 #include <vector>
 #include "Sequence.h"
+#include "OutputStream.h"
 
 using namespace std;
 
+// Records are collected in a large buffer that is handed to the output stream
+// in one piece. Files named *.gz or *.bgz are written BGZF compressed.
 class Writer
 {
 public:
@@ -51,10 +54,16 @@ public:
 
 protected:
 	void splitPrint(const string &seq, int num = 80);
+	void splitPrint(const char *seq, int len, int num);
+	void put(const char *data, size_t size);
+	void put(const string &str);
+	void put(char c);
+	bool flush();
 
 protected:
-    FILE *fout;
-	char *buf;
+    OutputStream *fout;
+	string buffer;
+	bool failed;
 };
 
 class FastAWriter: public Writer
@@ -66,6 +75,8 @@ public:
     bool Write(const string &seq, const string &comment);
     bool Write(const FastASequence &seq);
 	bool Write(const vector<FastASequence> &seq);
+	bool Write(const RecordBatch &batch, size_t i);
+	bool Write(const RecordBatch &batch);
 };
 
 class FastQWriter: public Writer
@@ -80,5 +91,7 @@ public:
 	bool Write(const vector<FastASequence> &seq);
 	bool Write(const FastQSequence &seq);
 	bool Write(const vector<FastQSequence> &seq);
+	bool Write(const RecordBatch &batch, size_t i);
+	bool Write(const RecordBatch &batch);
 };
 #endif
@@ -54,7 +54,7 @@ BreakpointCount breakpoints;
 
 bool readContigs(const string &fileName, Sequences &contigs)
 {
-    FastAReader reader;
+    MappedFastAReader reader;
     bool result = reader.Open(fileName) && reader.Read(contigs) > 0;
     reader.Close();
     return result;
@@ -46,6 +46,7 @@ Configuration::Configuration()
 {
 	Success = false;
 	InputFileName = "";
+	ReadFileExtension = ".fastq";
 }
 
 // Parses command line arguments. Returns true if successful.
@@ -83,6 +84,8 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				i++; string outputPrefix = argv[i];
 				PairedFilter.push_back(PairedInput(leftFileName, rightFileName, outputPrefix));
 			}
+			else if (!strcmp("-gzip", argv[i]))
+				this->ReadFileExtension = ".fastq.gz";
 			else if (i == argc - 1)
 				this->InputFileName = argv[argc - 1];
 			else
@@ -111,4 +114,5 @@ void Configuration::printHelpMessage(stringstream &serr)
 	serr << "[i] Usage: dataFilter [arguments] <contigs.fasta>" << endl;
 	serr << "[i] -help                                               Print this message and exit." << endl;
 	serr << "[i] -paired <left-file> <right-file> <output-prefix>    Filter paired reads and output them with given prefix." << endl;
+	serr << "[i] -gzip                                               Write the filtered reads BGZF compressed (.fastq.gz)." << endl;
 }
@@ -58,6 +58,7 @@ public:
 	string LastError;
 	vector<PairedInput> PairedFilter;
 	string InputFileName;
+	string ReadFileExtension;
 
 private:
 	void printHelpMessage(stringstream &serr);
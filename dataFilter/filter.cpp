@@ -85,7 +85,7 @@ bool processPairedReads(const PairedInput &input, const vector<ContigInfo> &cont
 	FastQWriter leftOut, rightOut;
 	if (!left.Open(input.LeftFileName) || !right.Open(input.RightFileName))
 		success = false;
-	if (success && (!leftOut.Open(input.OutputPrefix + "_1.fastq") || !rightOut.Open(input.OutputPrefix + "_2.fastq")))
+	if (success && (!leftOut.Open(input.OutputPrefix + "_1" + config.ReadFileExtension) || !rightOut.Open(input.OutputPrefix + "_2" + config.ReadFileExtension)))
 		success = false;
 	if (success)
 	{
@@ -41,7 +41,14 @@ Configuration::Configuration()
 	Success = false;
 	InputFileName = "";
 	OutputFileName = "output.opt";
+	BinaryOutput = false;
         ReadCoverageFileName = "";
+	RecordProvenance = true;
+	ProvenanceFileName = "";
+	LinkMemoryLimit = 0;
+	LibraryJobs = 1;
+	Threads = 0;
+	StreamAlignments = false;
 	MaximumLinkHits = 5;
 	NoOverlapDeviation = 0;
 }
@@ -264,6 +271,8 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				}
 				this->SequenceInputs.push_back(SequenceInput(fileName, sigma, weight, minReadLength));
 			}
+			else if (!strcmp("-binary", argv[i]))
+				this->BinaryOutput = true;
 			else if (!strcmp("-output", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -286,6 +295,86 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				i++;
 				this->ReadCoverageFileName = argv[i];
 			}
+			else if (!strcmp("-provenance", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -provenance: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				this->ProvenanceFileName = argv[i];
+			}
+			else if (!strcmp("-noprovenance", argv[i]))
+				this->RecordProvenance = false;
+			else if (!strcmp("-jobs", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -jobs: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool jobsSuccess;
+				LibraryJobs = Helpers::ParseInt(argv[i], jobsSuccess);
+				if (!jobsSuccess || LibraryJobs <= 0)
+				{
+					serr << "[-] Parsing error in -jobs: number of jobs must be a positive number." << endl;
+					this->Success = false;
+					break;
+				}
+			}
+			else if (!strcmp("-threads", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -threads: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool threadsSuccess;
+				Threads = Helpers::ParseInt(argv[i], threadsSuccess);
+				if (!threadsSuccess || Threads <= 0)
+				{
+					serr << "[-] Parsing error in -threads: number of threads must be a positive number." << endl;
+					this->Success = false;
+					break;
+				}
+			}
+			else if (!strcmp("-stream", argv[i]))
+				StreamAlignments = true;
+			else if (!strcmp("-linkmemory", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -linkmemory: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool memorySuccess;
+				LinkMemoryLimit = Helpers::ParseInt(argv[i], memorySuccess);
+				if (!memorySuccess || LinkMemoryLimit < 0)
+				{
+					serr << "[-] Parsing error in -linkmemory: memory limit must be a non-negative number." << endl;
+					this->Success = false;
+					break;
+				}
+			}
+			else if (!strcmp("-indexcache", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -indexcache: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				this->BWAConfig.IndexCachePath = this->NovoAlignConfig.IndexCachePath = argv[i];
+			}
 			else if (!strcmp("-tmp", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -370,6 +459,11 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 			serr << "[-] No input file specified." << endl;
 			this->Success = false;
 		}
+		else if (!this->RecordProvenance && this->ProvenanceFileName != "")
+		{
+			serr << "[-] -provenance and -noprovenance cannot be used together." << endl;
+			this->Success = false;
+		}
 	}
 	if (!this->Success)
 		LastError = serr.str();
@@ -396,7 +490,15 @@ void Configuration::printHelpMessage(stringstream &serr)
         serr << endl;
         serr << "[i] -readcoverage <filename>                            Produce contig read coverage data and output it to file <filename>. [disabled]" << endl;
 	serr << "[i] -output <filename>                                  Output filename for optimzation information. [output.opt]" << endl;
+	serr << "[i] -binary                                             Output optimization information in the binary store format. [off]" << endl;
+	serr << "[i] -provenance <filename>                              Output the names of the read pairs links were made from (by read pair id) to file <filename>. [disabled]" << endl;
+	serr << "[i] -noprovenance                                       Do not record read pair ids in links. [off]" << endl;
+	serr << "[i] -jobs <n>                                           Number of paired read libraries aligned at once, sharing the -bwathreads threads; also the number of sequence inputs aligned at once. [1]" << endl;
+	serr << "[i] -threads <n>                                         Number of threads used to merge the links of the inputs. [all cores]" << endl;
+	serr << "[i] -stream                                             Read alignments straight from the aligners instead of SAM/BAM files; libraries are processed one at a time. [off]" << endl;
+	serr << "[i] -linkmemory <MB>                                    Memory for links before they are spilled into sorted runs under the -tmp path, 0 for no limit. [0]" << endl;
 	serr << "[i] -tmp <path>                                         Define scrap path for temporary files. [/tmp]" << endl;
+	serr << "[i] -indexcache <path>                                  Keep aligner indexes of the contigs in <path> and reuse them across libraries and runs. [disabled]" << endl;
 	serr << "[i] BWA configuration options:" << endl;
 	serr << "[i] -bwathreads <n>                                     Number of threads used in BWA alignment. [8]" << endl;
 	serr << "[i] -bwahits <n>                                        Maximum number of alignment hits BWA should report. [1000]" << endl;
@@ -75,7 +75,14 @@ public:
 	bool Success;
 	string InputFileName;
 	string OutputFileName;
+	bool BinaryOutput;
 	string ReadCoverageFileName;
+	bool RecordProvenance;
+	string ProvenanceFileName;
+	int LinkMemoryLimit;
+	int LibraryJobs;
+	int Threads;
+	bool StreamAlignments;
         int MaximumLinkHits;
 	double NoOverlapDeviation;
 	BWAConfiguration BWAConfig;
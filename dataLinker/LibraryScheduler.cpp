@@ -0,0 +1,93 @@
+/*
+ * dataLinker : creates abstract contig links from the available information sources.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "LibraryScheduler.h"
+#include "Helpers.h"
+#include <algorithm>
+
+using namespace std;
+
+LibraryScheduler::LibraryScheduler(const Configuration &config, const vector<PairedInput> &libraries, int jobs)
+	: config(config), inputs(libraries), libraries(libraries.size()), next(0), stopping(false)
+{
+	jobs = max(1, min(jobs, (int)libraries.size()));
+	threads = max(1, config.BWAConfig.NumberOfThreads / jobs);
+	for (int i = 0; i < jobs; i++)
+		workers.push_back(thread(&LibraryScheduler::work, this));
+}
+
+LibraryScheduler::~LibraryScheduler()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (vector<Library>::const_iterator it = libraries.begin(); it != libraries.end(); it++)
+		if (it->Aligned && !it->Taken && it->Result == PairedReadConverter::Success)
+		{
+			Helpers::RemoveFile(it->LeftBamFileName);
+			Helpers::RemoveFile(it->RightBamFileName);
+		}
+}
+
+PairedReadConverter::PairedReadConverterResult LibraryScheduler::Take(int i, string &leftBamFileName, string &rightBamFileName)
+{
+	unique_lock<mutex> guard(lock);
+	while (!libraries[i].Aligned)
+		aligned.wait(guard);
+	Library &library = libraries[i];
+	library.Taken = true;
+	leftBamFileName = library.LeftBamFileName;
+	rightBamFileName = library.RightBamFileName;
+	return library.Result;
+}
+
+// Libraries are started in input order, so the one the caller waits for is never queued
+// behind later ones.
+void LibraryScheduler::work()
+{
+	while (true)
+	{
+		int i;
+		{
+			lock_guard<mutex> guard(lock);
+			if (stopping || next >= (int)libraries.size())
+				return;
+			i = next++;
+		}
+		string left, right;
+		PairedReadConverter::PairedReadConverterResult result = PairedReadConverter::Align(config, inputs[i], threads, left, right);
+		lock_guard<mutex> guard(lock);
+		libraries[i].Result = result;
+		libraries[i].LeftBamFileName = left;
+		libraries[i].RightBamFileName = right;
+		libraries[i].Aligned = true;
+		aligned.notify_all();
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * dataLinker : creates abstract contig links from the available information sources.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#ifndef _LIBRARYSCHEDULER_H
+#define _LIBRARYSCHEDULER_H
+
+#include "Configuration.h"
+#include "PairedReadConverter.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Aligns paired read libraries several at a time on worker threads, splitting the BWA
+// thread budget between them. Links are made from the alignments by the caller, one
+// library after another in input order, while the later libraries are still aligning,
+// so the store and read pair ids come out as when the libraries are processed in turn.
+class LibraryScheduler
+{
+public:
+	LibraryScheduler(const Configuration &config, const vector<PairedInput> &libraries, int jobs);
+	// Stops the workers and removes the alignments that were never taken.
+	~LibraryScheduler();
+
+public:
+	// Waits until library i is aligned; on success its BAM files are the caller's.
+	PairedReadConverter::PairedReadConverterResult Take(int i, string &leftBamFileName, string &rightBamFileName);
+
+private:
+	LibraryScheduler(const LibraryScheduler &);
+	LibraryScheduler &operator= (const LibraryScheduler &);
+
+	class Library
+	{
+	public:
+		Library() : Aligned(false), Taken(false), Result(PairedReadConverter::Success) {};
+
+	public:
+		bool Aligned, Taken;
+		PairedReadConverter::PairedReadConverterResult Result;
+		string LeftBamFileName, RightBamFileName;
+	};
+
+private:
+	void work();
+
+private:
+	const Configuration &config;
+	const vector<PairedInput> &inputs;
+	int threads;
+	vector<Library> libraries;
+	int next;
+	bool stopping;
+	mutex lock;
+	condition_variable aligned;
+	vector<thread> workers;
+};
+#endif
@@ -26,19 +26,24 @@
  */
 
 #include "PairedReadConverter.h"
-#include "Aligner.h"
-#include "Converter.h"
+#include "PairedAlignment.h"
 #include "Helpers.h"
 #include "AlignmentReader.h"
 #include <sstream>
 
 using namespace BamTools;
 
-PairedReadConverter::PairedReadConverter(DataStore &store)
-	: dataStore(store) 
+PairedReadConverter::PairedReadConverter(DataStore &store, LinkSink &links)
+	: dataStore(store), links(links), readPairCount(0), provenance(NULL)
 {
 }
 
+PairedReadConverter::~PairedReadConverter()
+{
+	if (provenance != NULL)
+		fclose(provenance);
+}
+
 bool PairedReadConverter::IsCorrectRelativeOrientation(const XATag &l, const XATag &r, bool isIllumina)
 {
 	return (isIllumina ? l.IsReverseStrand != r.IsReverseStrand : l.IsReverseStrand == r.IsReverseStrand);
@@ -46,74 +51,109 @@ bool PairedReadConverter::IsCorrectRelativeOrientation(const XATag &l, const XAT
 
 PairedReadConverter::PairedReadConverterResult PairedReadConverter::Process(const Configuration &config, const PairedInput &input)
 {
-	PairedReadConverterResult result = alignAndConvert(config, input);
+	if (config.StreamAlignments)
+		return processStreams(config, input);
+	string left, right;
+	PairedReadConverterResult result = Align(config, input, config.BWAConfig.NumberOfThreads, left, right);
+	if (result != Success)
+		return result;
+	return Process(config, input, left, right);
+}
+
+PairedReadConverter::PairedReadConverterResult PairedReadConverter::Process(const Configuration &config, const PairedInput &input, const string &leftBamFileName, const string &rightBamFileName)
+{
+	this->leftBamFileName = leftBamFileName;
+	this->rightBamFileName = rightBamFileName;
+	PairedReadConverterResult result = Success;
+	AlignmentReader leftReader, rightReader;
+	if (!leftReader.Open(leftBamFileName) || !rightReader.Open(rightBamFileName))
+		result = FailedLinkCreation;
 	if (result == Success)
-	{
-            string groupName = (input.IsIllumina ? "Ilumina paired read alignment" : "454 paired read alignment");
-            stringstream groupDescription;
-            groupDescription << (input.IsIllumina ? "Illumina" : "454") << " paired reads: " << input.LeftFileName << " & " << input.RightFileName << " with " << input.Mean << " +/- " << input.Std << " of weight " << input.Weight;
-            int groupId = dataStore.AddGroup(LinkGroup(groupName, groupDescription.str()));
-            result = createLinksFromAlignment(groupId, config.MaximumLinkHits, input, config.NoOverlapDeviation);
-	}
+		result = processAlignments(config, input, leftReader, rightReader);
+	leftReader.Close();
+	rightReader.Close();
 	removeBamFiles();
 	return result;
 }
 
-PairedReadConverter::PairedReadConverterResult PairedReadConverter::alignAndConvert(const Configuration &config, const PairedInput &input)
+// Reads the SAM output of both aligners from pipes as it is made, so that no SAM or BAM
+// files are written for the library.
+PairedReadConverter::PairedReadConverterResult PairedReadConverter::processStreams(const Configuration &config, const PairedInput &input)
 {
-	Aligner *leftAlignment, *rightAlignment;
-	PairedReadConverterResult result = Success;
-	bool success = true;
+	PairedAlignment alignment(config.InputFileName, input.LeftFileName, input.RightFileName, input.IsIllumina, config.BWAConfig, config.NovoAlignConfig, config.SAMToolsConfig);
+	FILE *leftStream, *rightStream;
+	switch (alignment.OpenStreams(leftStream, rightStream))
+	{
+	case PairedAlignment::FailedLeftAlignment:
+		return FailedLeftAlignment;
+	case PairedAlignment::FailedRightAlignment:
+		return FailedRightAlignment;
+	default:
+		break;
+	}
 
-	leftAlignment = (input.IsIllumina ? (Aligner *)new BWAAligner(config.InputFileName, input.LeftFileName, config.BWAConfig) : new NovoAlignAligner(config.InputFileName, input.LeftFileName, config.NovoAlignConfig));
-	rightAlignment = (input.IsIllumina ? (Aligner *)new BWAAligner(config.InputFileName, input.RightFileName, config.BWAConfig) : new NovoAlignAligner(config.InputFileName, input.RightFileName, config.NovoAlignConfig));
+	AlignmentReader leftReader, rightReader;
+	PairedReadConverterResult result = Success;
+	if (!leftReader.Open(leftStream) || !rightReader.Open(rightStream))
+		result = FailedLinkCreation;
+	if (result == Success)
+		result = processAlignments(config, input, leftReader, rightReader);
+	leftReader.Close();
+	rightReader.Close();
 
-	success = success && leftAlignment->Align();
-	if (!success)
-		result = FailedLeftAlignment;
-	else
+	switch (alignment.CloseStreams())
 	{
-		success = success && rightAlignment->Align();
-		if (!success)
-			result = FailedRightAlignment;
+	case PairedAlignment::FailedLeftAlignment:
+		return (result == Success ? FailedLeftAlignment : result);
+	case PairedAlignment::FailedRightAlignment:
+		return (result == Success ? FailedRightAlignment : result);
+	default:
+		return result;
 	}
+}
 
-	Converter leftConverter(leftAlignment->OutputFileName, config.SAMToolsConfig);
-	Converter rightConverter(rightAlignment->OutputFileName, config.SAMToolsConfig);
-	if (success)
+PairedReadConverter::PairedReadConverterResult PairedReadConverter::processAlignments(const Configuration &config, const PairedInput &input, AlignmentReader &leftReader, AlignmentReader &rightReader)
+{
+	PairedReadConverterResult result = Success;
+	if (!config.ProvenanceFileName.empty() && provenance == NULL && (provenance = fopen(config.ProvenanceFileName.c_str(), "w")) == NULL)
+		result = FailedProvenanceOutput;
+	if (result == Success)
 	{
-		success = success && leftConverter.Convert();
-		if (!success)
-			result = FailedLeftConversion;
-		else
-		{
-			success = success && rightConverter.Convert();
-			if (!success)
-				result = FailedRightConversion;
-		}
+            string groupName = (input.IsIllumina ? "Ilumina paired read alignment" : "454 paired read alignment");
+            stringstream groupDescription;
+            groupDescription << (input.IsIllumina ? "Illumina" : "454") << " paired reads: " << input.LeftFileName << " & " << input.RightFileName << " with " << input.Mean << " +/- " << input.Std << " of weight " << input.Weight;
+            int groupId = dataStore.AddGroup(LinkGroup(groupName, groupDescription.str()));
+            result = createLinksFromAlignment(leftReader, rightReader, groupId, config.MaximumLinkHits, input, config.NoOverlapDeviation, config.RecordProvenance);
 	}
+	return result;
+}
 
-	if (success)
+PairedReadConverter::PairedReadConverterResult PairedReadConverter::Align(const Configuration &config, const PairedInput &input, int threads, string &leftBamFileName, string &rightBamFileName)
+{
+	BWAConfiguration bwaConfig = config.BWAConfig;
+	bwaConfig.NumberOfThreads = threads;
+	PairedAlignment alignment(config.InputFileName, input.LeftFileName, input.RightFileName, input.IsIllumina, bwaConfig, config.NovoAlignConfig, config.SAMToolsConfig);
+	switch (alignment.Run())
 	{
-		leftConverter.RemoveOutput = rightConverter.RemoveOutput = false;
-		leftBamFileName = leftConverter.OutputFileName;
-		rightBamFileName = rightConverter.OutputFileName;
-		//cout << input.IsIllumina << " " << input.LeftFileName << " " << leftBamFileName << endl;
-		//cout << input.IsIllumina << " " << input.RightFileName << " " << rightBamFileName << endl;
+	case PairedAlignment::FailedLeftAlignment:
+		return FailedLeftAlignment;
+	case PairedAlignment::FailedRightAlignment:
+		return FailedRightAlignment;
+	case PairedAlignment::FailedLeftConversion:
+		return FailedLeftConversion;
+	case PairedAlignment::FailedRightConversion:
+		return FailedRightConversion;
+	default:
+		break;
 	}
-
-	delete leftAlignment;
-	delete rightAlignment;
-
-	return result;
+	leftBamFileName = alignment.LeftBamFileName;
+	rightBamFileName = alignment.RightBamFileName;
+	return Success;
 }
 
-PairedReadConverter::PairedReadConverterResult PairedReadConverter::createLinksFromAlignment(int groupId, int maxHits, const PairedInput &input, double noOverlapDeviation)
+PairedReadConverter::PairedReadConverterResult PairedReadConverter::createLinksFromAlignment(AlignmentReader &leftReader, AlignmentReader &rightReader, int groupId, int maxHits, const PairedInput &input, double noOverlapDeviation, bool recordProvenance)
 {
 	PairedReadConverterResult result = Success;
-	AlignmentReader leftReader, rightReader;
-	if (!leftReader.Open(leftBamFileName) || !rightReader.Open(rightBamFileName))
-		result = FailedLinkCreation;
         if (leftReader.GetReferenceCount() != rightReader.GetReferenceCount())
             result = InconsistentReferenceSets;
 
@@ -132,26 +172,40 @@ PairedReadConverter::PairedReadConverterResult PairedReadConverter::createLinksF
             {
                 processCoverage(leftAlignment, leftTags);
                 processCoverage(rightAlignment, rightTags);
-                createLinksForPair(groupId, leftAlignment, leftTags, rightAlignment, rightTags, input, noOverlapDeviation, maxHits);
+                int64_t readPair = (recordProvenance ? readPairCount : -1);
+                readPairCount++;
+                if (createLinksForPair(groupId, leftAlignment, leftTags, rightAlignment, rightTags, input, noOverlapDeviation, maxHits, readPair) && provenance != NULL)
+                    fprintf(provenance, "%lli\t%s\t%s\n", (long long)readPair, leftAlignment.Name.c_str(), rightAlignment.Name.c_str());
+                // a sink that could not spill drops every later link
+                if (links.Failed())
+                {
+                    result = FailedLinkCreation;
+                    break;
+                }
             }
+            if (provenance != NULL && fflush(provenance) != 0)
+                result = FailedProvenanceOutput;
         }
-	leftReader.Close();
-	rightReader.Close();
 	return result;
 }
 
-void PairedReadConverter::createLinksForPair(int groupId, const BamAlignment &leftAlg, const vector<XATag> &leftTags, const BamAlignment &rightAlg, const vector<XATag> &rightTags, const PairedInput &input, double noOverlapDeviation, int maxHits)
+// Returns whether any link was made from the pair.
+bool PairedReadConverter::createLinksForPair(int groupId, const BamAlignment &leftAlg, const vector<XATag> &leftTags, const BamAlignment &rightAlg, const vector<XATag> &rightTags, const PairedInput &input, double noOverlapDeviation, int maxHits, int64_t readPair)
 {
 	int combinations = leftTags.size() * rightTags.size();
 	if (combinations > maxHits || combinations == 0)
-		return;
+		return false;
+	bool added = false;
 	for (vector<XATag>::const_iterator l = leftTags.begin(); l != leftTags.end(); l++)
 		for (vector<XATag>::const_iterator r = rightTags.begin(); r != rightTags.end(); r++)
 		{
 			if (l->RefID == r->RefID)
 				continue;
-			addLinkForTagPair(groupId, *l, leftAlg, *r, rightAlg, input, noOverlapDeviation, combinations);
+			added = addLinkForTagPair(groupId, *l, leftAlg, *r, rightAlg, input, noOverlapDeviation, readPair, combinations) || added;
+			if (links.Failed())
+				return false;
 		}
+	return added;
 }
 
 void PairedReadConverter::processCoverage(const BamAlignment &alg, const vector<XATag> &tags)
@@ -164,10 +218,10 @@ void PairedReadConverter::processCoverage(const BamAlignment &alg, const vector<
     ContigReadCoverage.UpdateAverage(readLength);
 }
 
-void PairedReadConverter::addLinkForTagPair(int groupId, const XATag &l, const BamAlignment &leftAlg, const XATag &r, const BamAlignment &rightAlg, const PairedInput &input, double noOverlapDeviation, int factor)
+bool PairedReadConverter::addLinkForTagPair(int groupId, const XATag &l, const BamAlignment &leftAlg, const XATag &r, const BamAlignment &rightAlg, const PairedInput &input, double noOverlapDeviation, int64_t readPair, int factor)
 {
-	int lRefLen = dataStore[l.RefID].Sequence.Nucleotides.length();
-	int rRefLen = dataStore[r.RefID].Sequence.Nucleotides.length();
+	int lRefLen = dataStore[l.RefID].Length();
+	int rRefLen = dataStore[r.RefID].Length();
 	int lLen = leftAlg.Length;
 	int rLen = rightAlg.Length;
 	bool equalOrientation = (l.IsReverseStrand ^ r.IsReverseStrand ? input.IsIllumina : !input.IsIllumina);
@@ -176,14 +230,14 @@ void PairedReadConverter::addLinkForTagPair(int groupId, const XATag &l, const B
 	double readDistance = 0;
 
 	if (l.Position + lLen >= lRefLen || r.Position + rLen >= rRefLen)
-		return;
+		return false;
 	if (leftAlg.MapQuality < input.MapQ || rightAlg.MapQuality < input.MapQ)
-		return;
+		return false;
 	if (lLen < input.MinReadLength || rLen < input.MinReadLength)
-		return;
+		return false;
 	int leftEdit, rightEdit;
 	if (!leftAlg.GetTag("NM", leftEdit) || !rightAlg.GetTag("NM", rightEdit) || leftEdit > input.MaxEditDistance || rightEdit > input.MaxEditDistance)
-		return;
+		return false;
 
 	if (!input.IsIllumina)
 	{
@@ -233,12 +287,11 @@ void PairedReadConverter::addLinkForTagPair(int groupId, const XATag &l, const B
 	}
 
 	if (noOverlapDeviation > Helpers::Eps && readDistance > input.Mean + noOverlapDeviation * input.Std)
-		return;
+		return false;
 
-	string comment = leftAlg.Name + "+" + rightAlg.Name;
-	ContigLink link(l.RefID, r.RefID, distance, input.Std, equalOrientation, forwardOrder, input.Weight / (double)factor, comment);
+	ContigLink link(l.RefID, r.RefID, distance, input.Std, equalOrientation, forwardOrder, input.Weight / (double)factor, string(), LinkProvenance(readPair));
 	link.Ambiguous = factor > 1;
-	dataStore.AddLink(groupId, link);
+	return links.Add(groupId, link);
 }
 
 void PairedReadConverter::removeBamFiles()
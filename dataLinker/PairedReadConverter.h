@@ -30,36 +30,54 @@
 
 #include "Configuration.h"
 #include "DataStore.h"
+#include "LinkSink.h"
 #include "XATag.h"
 #include "ReadCoverage.h"
+#include "AlignmentReader.h"
 #include <vector>
+#include <cstdio>
+#include <stdint.h>
 
 using namespace std;
 
 class PairedReadConverter
 {
 public:
-	PairedReadConverter(DataStore &store);
+	PairedReadConverter(DataStore &store, LinkSink &links);
+	~PairedReadConverter();
 	static bool IsCorrectRelativeOrientation(const XATag &l, const XATag &r, bool isIllumina);
-        enum PairedReadConverterResult { Success, FailedLeftAlignment, FailedRightAlignment, FailedLeftConversion, FailedRightConversion, FailedLinkCreation, InconsistentReferenceSets };
+        enum PairedReadConverterResult { Success, FailedLeftAlignment, FailedRightAlignment, FailedLeftConversion, FailedRightConversion, FailedLinkCreation, InconsistentReferenceSets, FailedProvenanceOutput };
 
 public:
+	// Aligns the library and makes links from it, reading the alignments straight from the
+	// aligners when config.StreamAlignments is set.
 	PairedReadConverterResult Process(const Configuration &config, const PairedInput &input);
+	// Aligns the mates of a library to BAM files with the given number of BWA threads.
+	// Touches no converter state, so libraries can be aligned on several threads at once.
+	static PairedReadConverterResult Align(const Configuration &config, const PairedInput &input, int threads, string &leftBamFileName, string &rightBamFileName);
+	// Makes links from the BAM files of a library aligned by Align and removes them.
+	PairedReadConverterResult Process(const Configuration &config, const PairedInput &input, const string &leftBamFileName, const string &rightBamFileName);
 
 public:
     ReadCoverage ContigReadCoverage;
         
 private:
-	PairedReadConverterResult alignAndConvert(const Configuration &config, const PairedInput &input);
-	PairedReadConverterResult createLinksFromAlignment(int groupId, int maxHits, const PairedInput &input, double noOverlapDeviation);
-        void createLinksForPair(int groupId, const BamAlignment &leftAlg, const vector<XATag> &leftTags, const BamAlignment &rightAlg, const vector<XATag> &rightTags, const PairedInput &input, double noOverlapDeviation, int maxHits);
+	PairedReadConverterResult processStreams(const Configuration &config, const PairedInput &input);
+	PairedReadConverterResult processAlignments(const Configuration &config, const PairedInput &input, AlignmentReader &leftReader, AlignmentReader &rightReader);
+	PairedReadConverterResult createLinksFromAlignment(AlignmentReader &leftReader, AlignmentReader &rightReader, int groupId, int maxHits, const PairedInput &input, double noOverlapDeviation, bool recordProvenance);
+        bool createLinksForPair(int groupId, const BamAlignment &leftAlg, const vector<XATag> &leftTags, const BamAlignment &rightAlg, const vector<XATag> &rightTags, const PairedInput &input, double noOverlapDeviation, int maxHits, int64_t readPair);
         void processCoverage(const BamAlignment &alg, const vector<XATag> &tags);
-	void addLinkForTagPair(int groupId, const XATag &l, const BamAlignment &leftAlg, const XATag &r, const BamAlignment &rightAlg, const PairedInput &input, double noOverlapDeviation, int factor = 1);
+	bool addLinkForTagPair(int groupId, const XATag &l, const BamAlignment &leftAlg, const XATag &r, const BamAlignment &rightAlg, const PairedInput &input, double noOverlapDeviation, int64_t readPair, int factor = 1);
 	void removeBamFiles();
 
 private:
 	DataStore &dataStore;
+	LinkSink &links;
 	string leftBamFileName;
 	string rightBamFileName;
+	// Read pairs of all libraries are numbered in input order; their names go to the
+	// provenance file, if any, instead of into the links.
+	int64_t readPairCount;
+	FILE *provenance;
 };
 #endif
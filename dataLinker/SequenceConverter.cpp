@@ -34,8 +34,8 @@
 
 using namespace std;
 
-SequenceConverter::SequenceConverter(DataStore &store)
-     : dataStore(store) 
+SequenceConverter::SequenceConverter(const DataStore &store, DataStoreBuilder::Shard &shard)
+     : dataStore(store), shard(shard) 
 {
 }
 
@@ -57,14 +57,14 @@ int SequenceConverter::addLinkGroup(const SequenceInput &input)
     stringstream ss;
     ss << "Alignment to sequences " << input.FileName << " with " << input.Std << " of weight " << input.Weight;
     LinkGroup group("Reference sequence alignment", ss.str());
-    return dataStore.AddGroup(group);
+    return shard.AddGroup(group);
 }
 
 SequenceConverter::SequenceConverterResult SequenceConverter::alignContigs(const string &sequenceFileName, const Configuration &config, Coords &coords)
 {
     MummerTiler tiler(sequenceFileName, config.InputFileName, config.MummerTilerConfig);
     std::vector<FastASequence> references;
-    FastAReader faReader;
+    MappedFastAReader faReader;
     if (!faReader.Open(sequenceFileName) || faReader.Read(references) <= 0)
         return FailedReadSequences;
     MummerTilingReader reader(references, dataStore.GetContigs());
@@ -88,7 +88,7 @@ void SequenceConverter::createLinksFromAlignment(int groupID, Coords &tilings, c
             bool forwardOrder = !prev->IsReverse;
             double weight = input.Weight * cur->Identity * prev->Identity * prev->Coverage * cur->Coverage;
             ContigLink link(prev->QueryID, cur->QueryID, distance, input.Std, equalOrientation, forwardOrder, weight);
-            dataStore.AddLink(groupID, link);
+            shard.AddLink(groupID, link);
             //cout << "   added link between " << prev->QueryID << " and " << cur->QueryID << " of weight " << weight << endl;
         }
     }
@@ -30,6 +30,7 @@
 
 #include "Configuration.h"
 #include "DataStore.h"
+#include "DataStoreBuilder.h"
 #include "MummerTiling.h"
 
 #include <string>
@@ -40,7 +41,8 @@ typedef std::vector<MummerTiling> Coords;
 class SequenceConverter
 {
 public:
-    SequenceConverter(DataStore &store);
+    // Groups and links go to shard; the store only provides the contigs.
+    SequenceConverter(const DataStore &store, DataStoreBuilder::Shard &shard);
     enum SequenceConverterResult { Success, FailedAlignment, FailedReadAlignment, FailedReadSequences };
 
 public:
@@ -53,7 +55,8 @@ private:
     static void sortAlignments(Coords &coords);
     
 private:
-    DataStore &dataStore;
+    const DataStore &dataStore;
+    DataStoreBuilder::Shard &shard;
 };
 
 #endif	/* _SEQUENCECONVERTER_H */
@@ -26,14 +26,21 @@
  */
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <ctime>
 #include <cstddef>
 #include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
 #include <vector>
 #include "Configuration.h"
 #include "DataStore.h"
 #include "PairedReadConverter.h"
+#include "LibraryScheduler.h"
 #include "SequenceConverter.h"
+#include "DataStoreBuilder.h"
 #include "DataStoreWriter.h"
 #include "ReadCoverage.h"
 #include "ReadCoverageWriter.h"
@@ -44,15 +51,27 @@ Configuration config;
 DataStore store;
 ReadCoverage coverage;
 
-bool processPairs(const Configuration &config, DataStore &store, const vector<PairedInput> &paired, ReadCoverage &coverage)
+bool processPairs(const Configuration &config, DataStore &store, LinkSink &links, const vector<PairedInput> &paired, ReadCoverage &coverage)
 {
-	PairedReadConverter converter(store);
+	PairedReadConverter converter(store, links);
+	// libraries are aligned ahead on worker threads; links are made from them in input order
+	unique_ptr<LibraryScheduler> scheduler(config.StreamAlignments ? NULL : new LibraryScheduler(config, paired, config.LibraryJobs));
 	int n = (int)paired.size();
 	for (int i = 0; i < n; i++)
 	{
 		PairedInput p = paired[i];
 		cerr << "   [i] Processing " << (p.IsIllumina ? "Illumina" : "454") << " paired reads (" << p.LeftFileName << ", " << p.RightFileName << ") of weight " << p.Weight << " with insert size " << p.Mean << " +/- " << p.Std << endl; 
-		switch (converter.Process(config, paired[i]))
+		PairedReadConverter::PairedReadConverterResult result;
+		if (scheduler.get() == NULL)
+			result = converter.Process(config, paired[i]);
+		else
+		{
+			string leftBamFileName, rightBamFileName;
+			result = scheduler->Take(i, leftBamFileName, rightBamFileName);
+			if (result == PairedReadConverter::Success)
+				result = converter.Process(config, paired[i], leftBamFileName, rightBamFileName);
+		}
+		switch (result)
 		{
 		case PairedReadConverter::Success:
 			cerr << "      [+] Successfully processed paired reads." << endl;
@@ -75,21 +94,45 @@ bool processPairs(const Configuration &config, DataStore &store, const vector<Pa
                 case PairedReadConverter::InconsistentReferenceSets:
                         cerr << "      [-] Inconsistent reference sets in alignments." << endl;
                         return false;
+		case PairedReadConverter::FailedProvenanceOutput:
+			cerr << "      [-] Unable to output read pair provenance into file (" << config.ProvenanceFileName << ")." << endl;
+			return false;
 		}
 	}
         coverage = converter.ContigReadCoverage;
 	return true;
 }
 
-bool processSequences(const Configuration &config, DataStore &store, const vector<SequenceInput> &sequences)
+// Aligns the sequence inputs not yet taken, each into its own shard, until none is left.
+void convertSequences(const Configuration &config, const DataStore &store, DataStoreBuilder &builder, const vector<SequenceInput> &sequences, vector<SequenceConverter::SequenceConverterResult> &results, atomic<int> &next)
+{
+    int i;
+    while ((i = next++) < (int)sequences.size())
+    {
+        SequenceConverter converter(store, builder[i]);
+        results[i] = converter.Process(config, sequences[i]);
+    }
+}
+
+bool processSequences(const Configuration &config, DataStore &store, LinkSink &links, const vector<SequenceInput> &sequences)
 {
-    SequenceConverter converter(store);
     int n = (int)sequences.size();
+    // every input fills a shard of its own, up to LibraryJobs inputs at a time; the shards
+    // are merged into the store in input order, so the links are as when run one by one
+    DataStoreBuilder builder(n);
+    vector<SequenceConverter::SequenceConverterResult> results(n, SequenceConverter::Success);
+    atomic<int> next(0);
+    vector<thread> workers;
+    int jobs = max(1, min(config.LibraryJobs, n));
+    for (int i = 0; i < jobs; i++)
+        workers.push_back(thread(convertSequences, cref(config), cref(store), ref(builder), cref(sequences), ref(results), ref(next)));
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
     for (int i = 0; i < n; i++)
     {
         SequenceInput s = sequences[i];
         cerr << "   [i] Processing sequences (" << s.FileName << ") of weight " << s.Weight << " and deviation " << s.Std << endl;
-        switch (converter.Process(config, s))
+        switch (results[i])
         {
             case SequenceConverter::Success:
                 cerr << "      [+] Successfully processed sequences." << endl;
@@ -105,13 +148,13 @@ bool processSequences(const Configuration &config, DataStore &store, const vecto
                 return false;
         }
     }
-    return true;
+    return builder.Merge(store, links);
 }
 
-bool writeStore(const DataStore &store, const string &fileName)
+bool writeStore(const DataStore &store, LinkSink &links, const string &fileName, bool binary)
 {
 	DataStoreWriter writer;
-	bool result = writer.Open(fileName) && writer.Write(store);
+	bool result = writer.Open(fileName) && writer.Write(store, links, binary);
 	writer.Close();
 	return result;
 }
@@ -138,18 +181,22 @@ int main(int argc, char *argv[])
 	srand((unsigned int)time(NULL));
 	if (config.ProcessCommandLine(argc, argv))
 	{
-		if (!store.ReadContigs(config.InputFileName))
+		if (config.Threads > 0)
+			DataStore::Threads = config.Threads;
+		if (!store.ReadContigs(config.InputFileName, true))
 		{
                     cerr << "[-] Unable to read contigs from file (" << config.InputFileName << ")." << endl;
                     return -2;
 		}
 		cerr << "[+] Read input contigs from file (" << config.InputFileName << ")." << endl;
+		// links go to a sink that spills sorted runs to the scratch path when over the limit
+		LinkSink links((size_t)config.LinkMemoryLimit << 20, config.BWAConfig.TmpPath);
 		cerr << "[i] Processing paired reads." << endl;
-		if (!processPairs(config, store, config.PairedReadInputs, coverage))
+		if (!processPairs(config, store, links, config.PairedReadInputs, coverage))
 			return -3;
-                if (!processSequences(config, store, config.SequenceInputs))
+                if (!processSequences(config, store, links, config.SequenceInputs))
 			return -4;
-		if (!writeStore(store, config.OutputFileName))
+		if (!writeStore(store, links, config.OutputFileName, config.BinaryOutput))
 		{
                     cerr << "[-] Unable to output generated links into file (" << config.OutputFileName << ")." << endl;
                     return -5;
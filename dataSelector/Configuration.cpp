@@ -76,6 +76,7 @@ Configuration::Configuration()
 {
 	InputFastaFileName = "";
 	OutputFastaFileName = "";
+	ReadFileExtension = ".fastq";
 	PrintChromosomeInfo = false;
 	Select.clear();
 	Segments.clear();
@@ -224,6 +225,8 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				i++;
 				OutputFastaFileName = argv[i];
 			}
+			else if (!strcmp("-gzip", argv[i]))
+				ReadFileExtension = ".fastq.gz";
 			else if (!strcmp("-paired", argv[i]))
 			{
 				if (argc - i - 1 < 3)
@@ -335,4 +338,6 @@ void Configuration::printHelpMessage(stringstream &serr)
 	serr << "[i] -simulate-paired <mean-length> <std-length>               Simulate paired reads with given read length and insert size and output two read" << endl;
 	serr << "    <mean-insert> <std-insert> <depth> <output prefix> [type] files with given prefix. Type is Illumina or 454. [Illumina]" << endl;
 	serr << "[i] -output [sequence.fasta]                                  Output filename for the selected sequences. [out.fasta]" << endl;
+	serr << "                                                              Names ending in .gz are written BGZF compressed." << endl;
+	serr << "[i] -gzip                                                     Write paired read files BGZF compressed (.fastq.gz)." << endl;
 }
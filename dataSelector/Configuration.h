@@ -101,6 +101,7 @@ public:
 	string LastError;
 	string InputFastaFileName;
 	string OutputFastaFileName;
+	string ReadFileExtension;
 	bool PrintChromosomeInfo;
 	vector<Segment> Segments;
 	vector<ConfigSelect> Select;
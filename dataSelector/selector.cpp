@@ -42,7 +42,7 @@
 #include "Writer.h"
 #include "XATag.h"
 #include "Helpers.h"
-#include "api/BamReader.h"
+#include "AlignmentReader.h"
 
 using namespace std;
 using namespace BamTools;
@@ -243,63 +243,21 @@ bool outputSegmentSequences()
 	return res;
 }
 
-void getReferenceIDs(BamReader &reader, vector<int> &ids)
+void getReferenceIDs(const AlignmentReader &reader, vector<int> &ids)
 {
 	int nContigs = contigs.size();
 	ids.resize(nContigs, -1);
 
-	RefVector bam1vector = reader.GetReferenceData();
-	for (RefVector::iterator it = bam1vector.begin(); it != bam1vector.end(); it++)
+	const RefVector &bam1vector = reader.GetReferences();
+	for (int id = 0; id < (int)bam1vector.size(); id++)
 		for (int i = 0; i < nContigs; i++)
-			if (it->RefName == contigs[i].Name())
+			if (bam1vector[id].RefName == contigs[i].Name())
 			{
-				ids[i] = reader.GetReferenceID(it->RefName);
+				ids[i] = id;
 				break;
 			}
 }
 
-void convertToTags(const BamAlignment &alg, const BamReader &reader, vector<XATag> &tags)
-{
-	if (alg.IsMapped())
-	{
-		string xa;
-		tags.push_back(XATag(alg));
-		alg.GetTag("XA", xa);
-
-		int i = 0, s = 0;
-		int len = xa.length();
-		while (i < len)
-		{
-			for (int t = 0; t < 3; t++)
-			{
-				while (i < len && xa[i] != ',') i++;
-				i++;
-			}
-			while (i < len && xa[i] != ';') i++;
-			if (i == len)
-				break;
-			i++;
-			tags.push_back(XATag(xa.substr(s, s - i), reader));
-			s = ++i;
-		}
-	}
-}
-
-vector<XATag> convertToTags(const BamAlignment &alg, const BamReader &reader)
-{
-	vector<XATag> tags;
-	convertToTags(alg, reader, tags);
-	return tags;
-}
-
-vector<XATag> convertToTags(const vector<BamAlignment> &alg, const BamReader &reader)
-{
-	vector<XATag> tags;
-	for (vector<BamAlignment>::const_iterator it = alg.begin(); it != alg.end(); it++)
-		convertToTags(*it, reader, tags);
-	return tags;
-}
-
 bool alignmentOverlaps(const vector<XATag> tags, const vector<int> conv)
 {
 	if (tags.size() > MaxHits)
@@ -313,51 +271,11 @@ bool alignmentOverlaps(const vector<XATag> tags, const vector<int> conv)
 	return false;
 }
 
-bool getNextAlignmentGroup(BamReader &bam, BamAlignment &buffer, vector<BamAlignment> &alg, bool core = false)
-{
-	int n = 0;
-	alg.clear();
-	if (!buffer.Name.empty())
-	{
-		alg.push_back(buffer), n++;
-		buffer.Name.clear();
-	}
-
-	while (true)
-	{
-		 // EOF
-		if (core)
-		{
-			if (!bam.GetNextAlignmentCore(buffer))
-			{
-				buffer.Name.clear();
-				break;
-			}
-		}
-		else
-		{
-			if (!bam.GetNextAlignment(buffer))
-			{
-				buffer.Name.clear();
-				break;
-			}
-		}
-		
-		if (n == 0 || alg[n - 1].Name == buffer.Name)
-		{
-			alg.push_back(buffer), n++;
-			buffer.Name.clear();
-		}
-		else
-			break;
-	}
-
-	return alg.size() != 0;
-}
-
+// The BAM files are read twice: first to check that their read groups pair up, then to
+// select the pairs. Only the first alignment of each group is decoded in full.
 bool processPairedAlignment(const PairedBam &bam)
 {
-	BamReader bam1, bam2;
+	AlignmentReader bam1, bam2;
 	if (!bam1.Open(bam.InputBam1) || !bam2.Open(bam.InputBam2))
 		return false;
 
@@ -365,15 +283,13 @@ bool processPairedAlignment(const PairedBam &bam)
 	getReferenceIDs(bam1, bam1ref);
 	getReferenceIDs(bam2, bam2ref);
 	
-	vector<BamAlignment> alg1, alg2;
-	BamAlignment buffer1, buffer2;
-	buffer1.Name.clear();
-	buffer2.Name.clear();
+	BamAlignment alg1, alg2;
+	vector<XATag> tags1, tags2;
 	bool error = false;
 	while (!error)
 	{
-		bool read1 = getNextAlignmentGroup(bam1, buffer1, alg1, true);
-		bool read2 = getNextAlignmentGroup(bam2, buffer2, alg2, true);
+		bool read1 = bam1.GetNextAlignmentGroup(alg1, tags1);
+		bool read2 = bam2.GetNextAlignmentGroup(alg2, tags2);
 		if (!read1 && !read2)
 			break;
 		if (read1 ^ read2)
@@ -385,28 +301,29 @@ bool processPairedAlignment(const PairedBam &bam)
 
 	if (!error)
 	{
-		bam1.Rewind();	bam2.Rewind();
-		buffer1.Name = buffer2.Name = "";
+		bam1.Close();	bam2.Close();
 		FastQWriter w1, w2;
-		bool success = w1.Open(bam.OutputPrefix + "_1.fastq") && w2.Open(bam.OutputPrefix + "_2.fastq");
+		bool success = bam1.Open(bam.InputBam1) && bam2.Open(bam.InputBam2);
+		success = success && w1.Open(bam.OutputPrefix + "_1" + config.ReadFileExtension) && w2.Open(bam.OutputPrefix + "_2" + config.ReadFileExtension);
 		if (success)
 		{
 			while (true)
 			{
-				bool read1 = getNextAlignmentGroup(bam1, buffer1, alg1);
-				bool read2 = getNextAlignmentGroup(bam2, buffer2, alg2);
+				bool read1 = bam1.GetNextAlignmentGroup(alg1, tags1);
+				bool read2 = bam2.GetNextAlignmentGroup(alg2, tags2);
 				if (!read1 && !read2)
 					break;
-				string str1, str2;
-				if (alignmentOverlaps(convertToTags(alg1, bam1), bam1ref) || alignmentOverlaps(convertToTags(alg2, bam2), bam2ref))
+				if (alignmentOverlaps(tags1, bam1ref) || alignmentOverlaps(tags2, bam2ref))
 				{
-					w1.Write(FastQSequence(alg1[0]));
-					w2.Write(FastQSequence(alg2[0]));
+					w1.Write(FastQSequence(alg1));
+					w2.Write(FastQSequence(alg2));
 				}
 			}
 		}
 		w1.Close();
 		w2.Close();
+		if (!success)
+			error = true;
 	}
 	bam1.Close();
 	bam2.Close();
@@ -430,7 +347,7 @@ bool processPairedAlignments()
 bool generatePairedReads(const PairedSimulation &simulation, int &counter)
 {
 	FastQWriter w1, w2;
-	bool success = w1.Open(simulation.OutputPrefix + "_1.fastq") && w2.Open(simulation.OutputPrefix + "_2.fastq");
+	bool success = w1.Open(simulation.OutputPrefix + "_1" + config.ReadFileExtension) && w2.Open(simulation.OutputPrefix + "_2" + config.ReadFileExtension);
 	if (success)
 	{
 		for (int i = 0; i < (int)segmentSequence.size(); i++)
@@ -35,27 +35,15 @@
 using namespace std;
 
 Configuration config;
-vector<FastASequence> contigs;
 map<string, int> kmers;
 map<string, vector<Location> > locations;
 
-bool readContigs(const string &filename, vector<FastASequence> &contigs)
+void countKmers(int k, int id, const char *seq, int len, map<string, int> &kmers, map<string, vector<Location> > &locations)
 {
-	FastAReader reader;
-	bool success = reader.Open(filename);
-	int read = -1;
-	if (success)
-		read = reader.Read(contigs);
-	reader.Close();
-	return success && read > 0;
-}
-
-void countKmers(int k, int id, const FastASequence &seq, map<string, int> &kmers, map<string, vector<Location> > &locations)
-{
-	int len = seq.Nucleotides.length();
+	string kmer;
 	for (int i = 0; i < len - k; i++)
 	{
-		string kmer = seq.Nucleotides.substr(i, k);
+		kmer.assign(seq + i, k);
 		if (kmers.find(kmer) == kmers.end())
 		{
 			kmers[kmer] = 1;
@@ -67,14 +55,22 @@ void countKmers(int k, int id, const FastASequence &seq, map<string, int> &kmers
 	}
 }
 
-void countKmers(int k, const vector<FastASequence> &contigs, map<string, int> &kmers, map<string, vector<Location> > &locations)
+// Contigs are read and counted a batch at a time instead of being held in memory as a whole.
+bool countKmers(const string &filename, int k, map<string, int> &kmers, map<string, vector<Location> > &locations)
 {
-	int n = contigs.size();
-	for (int i = 0; i < n; i++)
-	{
-		cerr << "[i] Adding contig " << i + 1 << "." << endl;
-		countKmers(k, i, contigs[i], kmers, locations);
-	}
+	FastAReader reader;
+	if (!reader.Open(filename))
+		return false;
+	RecordBatch batch(1024);
+	int id = 0;
+	while (reader.Read(batch) > 0)
+		for (size_t i = 0; i < batch.Size(); i++, id++)
+		{
+			cerr << "[i] Adding contig " << id + 1 << "." << endl;
+			countKmers(k, id, batch.Nucleotides(i), batch.Length(i), kmers, locations);
+		}
+	reader.Close();
+	return id > 0;
 }
 
 void printKmers(const map<string, int> &kmers, bool verbose)
@@ -111,12 +107,11 @@ int main(int argc, char *argv[])
     banner();
 	if (config.ProcessCommandLine(argc, argv))
 	{
-		if (!readContigs(config.InputFileName, contigs))
+		if (!countKmers(config.InputFileName, config.Kmer, kmers, locations))
 		{
 			cerr << "[-] Unable to read contigs: " << config.InputFileName << endl;
 			return -1;
 		}
-		countKmers(config.Kmer, contigs, kmers, locations);
 		cerr << "[+] Outputing stats:" << endl;
 		printKmers(kmers, config.Verbose);
 		return 0;
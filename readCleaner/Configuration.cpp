@@ -40,6 +40,7 @@ using namespace std;
 Configuration::Configuration()
 {
 	Success = false;
+	ReadFileExtension = ".fastq";
 }
 
 // Parses command line arguments. Returns true if successful.
@@ -96,6 +97,17 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				string outputPrefix = argv[i];
 				this->PairedReadInputs.push_back(PairedInput(leftFileName, rightFileName, outputPrefix, true));
 			}
+			else if (!strcmp("-indexcache", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -indexcache: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				this->BWAConfig.IndexCachePath = this->NovoAlignConfig.IndexCachePath = argv[i];
+			}
 			else if (!strcmp("-tmp", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -107,6 +119,8 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				i++;
 				this->BWAConfig.TmpPath = this->NovoAlignConfig.TmpPath = this->SAMToolsConfig.TmpPath = argv[i];
 			}
+			else if (!strcmp("-gzip", argv[i]))
+				this->ReadFileExtension = ".fastq.gz";
 			else if (!strcmp("-bwathreads", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -195,6 +209,8 @@ void Configuration::printHelpMessage(stringstream &serr)
 	serr << "[i] -454 <left.fq> <right.fq> <output prefix>           Process 454 paired reads and output the filtered reads with new prefix." << endl;
 	serr << "[i] -illumina <left.fq> <right.fq> <output prefix>      Process Illumina paired reads and output the filtered reads with new prefix." << endl;
 	serr << "[i] -tmp <path>                                         Define scrap path for temporary files. [/tmp]" << endl;
+	serr << "[i] -indexcache <path>                                  Keep aligner indexes of the contigs in <path> and reuse them across libraries and runs. [disabled]" << endl;
+	serr << "[i] -gzip                                               Write the filtered reads BGZF compressed (.fastq.gz)." << endl;
 	serr << "[i] BWA configuration options:" << endl;
 	serr << "[i] -bwathreads <n>                                     Number of threads used in BWA alignment. [8]" << endl;
 	serr << "[i] -bwahits <n>                                        Maximum number of alignment hits BWA should report. [1000]" << endl;
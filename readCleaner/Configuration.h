@@ -61,6 +61,7 @@ public:
 	NovoAlignConfiguration NovoAlignConfig;
 	SAMToolsConfiguration SAMToolsConfig;
 	vector<PairedInput> PairedReadInputs;
+	string ReadFileExtension;
 	string LastError;
 
 private:
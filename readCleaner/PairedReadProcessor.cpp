@@ -27,8 +27,7 @@
  */
 
 #include "PairedReadProcessor.h"
-#include "Aligner.h"
-#include "Converter.h"
+#include "PairedAlignment.h"
 #include "Helpers.h"
 #include "AlignmentReader.h"
 #include "Writer.h"
@@ -47,66 +46,40 @@ PairedReadProcessor::PairedReadProcessorResult PairedReadProcessor::Process(cons
 {
 	PairedReadProcessorResult result = alignAndConvert(config, input);
 	if (result == Success)
-		result = processAlignment(input);
+		result = processAlignment(config, input);
 	removeBamFiles();
 	return result;
 }
 
 PairedReadProcessor::PairedReadProcessorResult PairedReadProcessor::alignAndConvert(const Configuration &config, const PairedInput &input)
 {
-	Aligner *leftAlignment, *rightAlignment;
-	PairedReadProcessorResult result = Success;
-	bool success = true;
-
-	leftAlignment = (input.IsIllumina ? (Aligner *)new BWAAligner(config.ReferenceFileName, input.LeftFileName, config.BWAConfig) : new NovoAlignAligner(config.ReferenceFileName, input.LeftFileName, config.NovoAlignConfig));
-	rightAlignment = (input.IsIllumina ? (Aligner *)new BWAAligner(config.ReferenceFileName, input.RightFileName, config.BWAConfig) : new NovoAlignAligner(config.ReferenceFileName, input.RightFileName, config.NovoAlignConfig));
-
-	success = success && leftAlignment->Align();
-	if (!success)
-		result = FailedLeftAlignment;
-	else
-	{
-		success = success && rightAlignment->Align();
-		if (!success)
-			result = FailedRightAlignment;
-	}
-
-	Converter leftConverter(leftAlignment->OutputFileName, config.SAMToolsConfig);
-	Converter rightConverter(rightAlignment->OutputFileName, config.SAMToolsConfig);
-	if (success)
-	{
-		success = success && leftConverter.Convert();
-		if (!success)
-			result = FailedLeftConversion;
-		else
-		{
-			success = success && rightConverter.Convert();
-			if (!success)
-				result = FailedRightConversion;
-		}
-	}
-
-	if (success)
+	PairedAlignment alignment(config.ReferenceFileName, input.LeftFileName, input.RightFileName, input.IsIllumina, config.BWAConfig, config.NovoAlignConfig, config.SAMToolsConfig);
+	switch (alignment.Run())
 	{
-		leftConverter.RemoveOutput = rightConverter.RemoveOutput = false;
-		leftBamFileName = leftConverter.OutputFileName;
-		rightBamFileName = rightConverter.OutputFileName;
+	case PairedAlignment::FailedLeftAlignment:
+		return FailedLeftAlignment;
+	case PairedAlignment::FailedRightAlignment:
+		return FailedRightAlignment;
+	case PairedAlignment::FailedLeftConversion:
+		return FailedLeftConversion;
+	case PairedAlignment::FailedRightConversion:
+		return FailedRightConversion;
+	default:
+		break;
 	}
-
-	delete leftAlignment;
-	delete rightAlignment;
-
-	return result;
+	leftBamFileName = alignment.LeftBamFileName;
+	rightBamFileName = alignment.RightBamFileName;
+	return Success;
 }
 
-PairedReadProcessor::PairedReadProcessorResult PairedReadProcessor::processAlignment(const PairedInput &input)
+PairedReadProcessor::PairedReadProcessorResult PairedReadProcessor::processAlignment(const Configuration &config, const PairedInput &input)
 {
 	PairedReadProcessorResult result = Success;
 	AlignmentReader leftReader, rightReader;
 	FastQWriter leftWriter, rightWriter;
 	if (!leftReader.Open(leftBamFileName) || !rightReader.Open(rightBamFileName))
 		result = FailedIO;
-	if (!leftWriter.Open(input.OutputPrefix + "_1.fastq") || !rightWriter.Open(input.OutputPrefix + "_2.fastq"))
+	if (!leftWriter.Open(input.OutputPrefix + "_1" + config.ReadFileExtension) || !rightWriter.Open(input.OutputPrefix + "_2" + config.ReadFileExtension))
 		result = FailedIO;
 	vector<XATag> leftTags, rightTags;
 	BamAlignment leftAlignment, rightAlignment;
@@ -45,7 +45,7 @@ public:
 
 private:
 	PairedReadProcessorResult alignAndConvert(const Configuration &config, const PairedInput &input);
-	PairedReadProcessorResult processAlignment(const PairedInput &input);
+	PairedReadProcessorResult processAlignment(const Configuration &config, const PairedInput &input);
 	void removeBamFiles();
 
 private:
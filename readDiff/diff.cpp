@@ -27,6 +27,7 @@
 
 #include "Configuration.h"
 #include "Reader.h"
+#include "ParallelReader.h"
 #include "Writer.h"
 #include <iostream>
 #include <algorithm>
@@ -36,46 +37,100 @@
 using namespace std;
 
 Configuration config;
-vector<FastQSequence> A, B;
+vector<RecordBatch> A, B;
 
-bool isNameLess(const FastQSequence &a, const FastQSequence &b)
+// Position of a record in a list of batches.
+class RecordRef
 {
-	return strcmp(a.Comment.c_str(), b.Comment.c_str()) < 0;
+public:
+	RecordRef(int batch, int index) : Batch(batch), Index(index) {};
+
+public:
+	int Batch;
+	int Index;
+};
+
+vector<RecordRef> orderA, orderB;
+
+class NameLess
+{
+public:
+	NameLess(const vector<RecordBatch> &batches) : batches(batches) {};
+
+public:
+	bool operator() (const RecordRef &a, const RecordRef &b) const
+	{
+		return strcmp(batches[a.Batch].Comment(a.Index), batches[b.Batch].Comment(b.Index)) < 0;
+	}
+
+private:
+	const vector<RecordBatch> &batches;
+};
+
+const char *nameOf(const vector<RecordBatch> &batches, const RecordRef &ref)
+{
+	return batches[ref.Batch].Comment(ref.Index);
 }
 
-bool readSet(const string &fileName, vector<FastQSequence> &reads)
+// Reads the file in batches parsed on all cores. Only read names are kept unless keepRecords is set.
+bool readSet(const string &fileName, vector<RecordBatch> &batches, vector<RecordRef> &order, bool keepRecords)
 {
-	FastQReader reader;
-	bool result = reader.Open(fileName) && reader.Read(reads) > 0;
+	ParallelFastQReader reader;
+	if (!reader.Open(fileName))
+		return false;
+	RecordBatch batch;
+	while (reader.Read(batch) > 0)
+	{
+		if (keepRecords)
+		{
+			batches.push_back(RecordBatch());
+			batches.back().Swap(batch);
+		}
+		else
+		{
+			batches.push_back(RecordBatch(batch.Size()));
+			for (size_t i = 0; i < batch.Size(); i++)
+				batches.back().Add(batch.Comment(i), batch.CommentLength(i), "", 0, "", 0);
+		}
+		for (size_t i = 0; i < batches.back().Size(); i++)
+			order.push_back(RecordRef(batches.size() - 1, i));
+	}
+	bool failed = reader.Failed();
 	reader.Close();
-	return result;
+	return !failed && order.size() > 0;
 }
 
-bool calculateDifference(const vector<FastQSequence> &A, const vector<FastQSequence> &B, const string &fileName)
+// Writes the reads of A whose names do not occur in B; both orders must be sorted by name.
+bool calculateDifference(const vector<RecordRef> &a, const vector<RecordRef> &b, const string &fileName)
 {
 	FastQWriter writer;
 	bool result = writer.Open(fileName);
 	int i = 0, j = 0;
-	int aSize = A.size(), bSize = B.size();
+	int aSize = a.size(), bSize = b.size();
 	while (result && (i < aSize || j < bSize))
 	{
 		if (j >= bSize)
-			result = result && writer.Write(A[i++]);
+		{
+			result = result && writer.Write(A[a[i].Batch], a[i].Index);
+			i++;
+		}
 		else if (i >= aSize)
 			j++;
 		else
 		{
-			int cmp = strcmp(A[i].Comment.c_str(), B[j].Comment.c_str());
+			int cmp = strcmp(nameOf(A, a[i]), nameOf(B, b[j]));
 			if (cmp == 0)
 				i++, j++;
 			else if (cmp < 0)
-				result = result && writer.Write(A[i++]);
+			{
+				result = result && writer.Write(A[a[i].Batch], a[i].Index);
+				i++;
+			}
 			else
 				j++;
 		}
 	}
-	writer.Close();
-	return result;
+	return writer.Close() && result;
 }
 
 void banner()
@@ -91,22 +146,22 @@ int main(int argc, char *argv[])
     banner();
 	if (config.ProcessCommandLine(argc, argv))
 	{
-		if (!readSet(config.AFileName, A))
+		if (!readSet(config.AFileName, A, orderA, true))
 		{
 			cerr << "[-] Unable to read first input file: " << config.AFileName << endl;
 			return -2;
 		}
-		cerr << "[+] Successfully read first input file." << endl;
-		if (!readSet(config.BFileName, B))
+		cerr << "[+] Successfully read first input file (" << orderA.size() << " reads)." << endl;
+		if (!readSet(config.BFileName, B, orderB, false))
 		{
 			cerr << "[-] Unable to read first input file: " << config.BFileName << endl;
 			return -3;
 		}
-		sort(A.begin(), A.end(), isNameLess);
-		sort(B.begin(), B.end(), isNameLess);
-		cerr << "[+] Successfully read second input file." << endl;
+		sort(orderA.begin(), orderA.end(), NameLess(A));
+		sort(orderB.begin(), orderB.end(), NameLess(B));
+		cerr << "[+] Successfully read second input file (" << orderB.size() << " reads)." << endl;
 		cerr << "[i] Calculating difference..." << endl;
-		if (!calculateDifference(A, B, config.CFileName))
+		if (!calculateDifference(orderA, orderB, config.CFileName))
 		{
 			cerr << "[-] Unable to calculate the difference." << endl;
 			return -4;
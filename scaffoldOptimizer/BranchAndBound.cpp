@@ -176,7 +176,7 @@ bool BranchAndBound::addContig(const Contig &contig)
 	int id = contig.GetID();
 	try
 	{
-		len[id] = contig.Sequence.Nucleotides.length();
+		len[id] = contig.Length();
 		x.add(IloNumVar(environment, 0, CoordMax));
 	}
 	catch (...)
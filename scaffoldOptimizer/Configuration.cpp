@@ -48,12 +48,16 @@ Configuration::Configuration()
 	PrintMatrix = false;
 	BundleDistance = 3.0;
 	Erosion = 5.0;
+	MaximumPartners = 0;
+	HubPercentile = 0;
         ExpectedCoverage = 0.0;
         UniquenessFCutoff = 5.0;
 	InputFileName = "";
         ReadCoverageFileName = "";
 	OutputFileName = "scaffold.fasta";
 	SolutionOutputFileName = "";
+	ProblemOutputFileName = "";
+	BinaryProblemOutput = false;
 }
 
 // Parses command line arguments. Returns true if successful.
@@ -260,6 +264,44 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				}
 				Erosion = erosion;
 			}
+			else if (!strcmp("-max-partners", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					cerr << "[-] Parsing error in -max-partners: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool partnersSuccess;
+				int partners = Helpers::ParseInt(argv[i], partnersSuccess);
+				if (!partnersSuccess || partners < 0)
+				{
+					cerr << "[-] Parsing error in -max-partners: number of partners must be a non-negative number." << endl;
+					this->Success = false;
+					break;
+				}
+				MaximumPartners = partners;
+			}
+			else if (!strcmp("-hub-percentile", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					cerr << "[-] Parsing error in -hub-percentile: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool percentileSuccess;
+				double percentile = Helpers::ParseDouble(argv[i], percentileSuccess);
+				if (!percentileSuccess || percentile < 0 || percentile > 100)
+				{
+					cerr << "[-] Parsing error in -hub-percentile: percentile must be a number from 0 to 100." << endl;
+					this->Success = false;
+					break;
+				}
+				HubPercentile = percentile;
+			}
                         else if (!strcmp("-overlap-deviation", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -339,6 +381,37 @@ bool Configuration::ProcessCommandLine(int argc, char *argv[])
 				i++;
 				SolutionOutputFileName = argv[i];
 			}
+			else if (!strcmp("-problem-output", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -problem-output: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				ProblemOutputFileName = argv[i];
+			}
+			else if (!strcmp("-problem-format", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -problem-format: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				if (!strcasecmp(argv[i], "binary"))
+					BinaryProblemOutput = true;
+				else if (!strcasecmp(argv[i], "text"))
+					BinaryProblemOutput = false;
+				else
+				{
+					serr << "[-] Parsing error in -problem-format: argument must be text/binary." << endl;
+					this->Success = false;
+					break;
+				}
+			}
 			else if (!strcmp("-print-matrix", argv[i]))
 			{
 				if (argc - i - 1 < 1)
@@ -619,13 +692,15 @@ void Configuration::printHelpMessage(stringstream &serr)
 	serr << "[i] -bundle-distance <distance>                         Bundle contig links withing <distance> standard deviation from the median. [3]" << endl;
         serr << "[i] -repeat-coverage <exp. cov.> <cov. filename> [F]    Detect repeats using expected coverage and read coverage provided in a file. [5]" << endl;
 	serr << "[i] -erosion <weight>                                   Remove contig links with weight smaller than <weigth> (should be used only with link bundling). [5]" << endl;
+	serr << "[i] -max-partners <k>                                   Keep links between two contigs only if each is among the <k> partners of the other with the largest link weight. [disabled]" << endl;
+	serr << "[i] -hub-percentile <p>                                 Remove all links of contigs with more partners than contigs at percentile <p> of linked contigs. [disabled]" << endl;
         serr << endl;
         serr << "[i] -overlap-deviation <length>                         Length by which contig distance is reduced to find better overlaps. [100]" << endl;
         serr << "[i] -max-alignment <length>                             Maximum contig overlap to perform global alignment on. Overlap deviation is not taken into account. [1500]" << endl;
         serr << "[i] -no-split <length>                                  Maximum predicted overlap length that is not confirmed by alignment, which does not cause scaffold splitting. [50]" << endl;
         serr << endl;
 	serr << "[i] -time-limit <seconds>                               Time limit for a single run of CPLEX or GA in seconds. [infinite]" << endl;
-	serr << "[i] -threads <n>                                        Number of threads a solver can use. [automatic]" << endl;
+	serr << "[i] -threads <n>                                        Number of threads a solver can use, also used to load and bundle links. [automatic; all cores for links]" << endl;
 	serr << "[i] -cplex-opportunistic <yes/no>                       Use CPLEX opportunistic optimization mode. [yes]" << endl;
 	serr << "[i] -cplex-heuristic <yes/no>                           Use CPLEX objective function heuristic. [yes]" << endl;
 	serr << "[i] -cplex-suppress <yes/no>                            Suppress CPLEX output. [yes]" << endl;
@@ -637,4 +712,6 @@ void Configuration::printHelpMessage(stringstream &serr)
 	serr << "[i] -verbose <yes/no/more>                              Verbose output of solvers? [no]" << endl;
 	serr << "[i] -output <output filename>                           Output filename for final scaffolds. [scaffold.fasta]" << endl;
 	serr << "[i] -solution-output <output filename>                  Output filename for optimzation solution. [not output]" << endl;
+	serr << "[i] -problem-output <output filename>                   Output filename for the optimization problem after link processing. [not output]" << endl;
+	serr << "[i] -problem-format <text/binary>                       Store format of -problem-output. [text]" << endl;
 }
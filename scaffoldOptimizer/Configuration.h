@@ -55,6 +55,8 @@ public:
 	bool BundleAmbiguous;
 	double BundleDistance;
 	double Erosion;
+	int MaximumPartners;
+	double HubPercentile;
         double ExpectedCoverage;
         double UniquenessFCutoff;
 	bool PrintMatrix;
@@ -64,6 +66,8 @@ public:
         string ReadCoverageFileName;
 	string OutputFileName;
 	string SolutionOutputFileName;
+	string ProblemOutputFileName;
+	bool BinaryProblemOutput;
 
 private:
 	void printHelpMessage(stringstream &serr);
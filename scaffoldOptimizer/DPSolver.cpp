@@ -48,12 +48,19 @@ bool DPSolver::Formulate(const DataStore &store)
 {
 	if (status != Clean)
 		return false;
-	ContigCount = store.ContigCount;
+	return Formulate(DataStore::Snapshot(store));
+}
+
+bool DPSolver::Formulate(const shared_ptr<const DataStore> &store)
+{
+	if (status != Clean)
+		return false;
+	ContigCount = store->ContigCount;
 	U.resize(ContigCount);
 	T.resize(ContigCount);
 	X.resize(ContigCount);
 	this->store = store;
-	graph = DPGraph(store);
+	graph = DPGraph(*store);
 	nComponents = graph.FindConnectedComponents(connectedComponents);
 	status = Formulated;
 	return true;
@@ -92,15 +99,18 @@ bool DPSolver::processComponents()
 	vector<double> maxX(nComponents);
 	vector< vector<int> > backTransform(nComponents);
 	vector<Scaffold> scaffolds;
+	vector<int> transGroup(store->GroupCount, -1);
 	MaxIteration = 0;
 	for (int i = 0; i < nComponents; i++)
 	{
 		int nContigsComponent = connectedComponents[i].size();
 		fprintf(stderr, "    [i] Processing component %i of size %i.\n", i + 1, nContigsComponent);
-		DataStore compStore;
+		// the component is extracted once and shared by all solvers working on it
+		DataStore component;
 		EMSolver *solver = new EMSolver();
 		solver->Options = Options;
-		store.Extract(connectedComponents[i], compStore, backTransform[i]);
+		store->Extract(connectedComponents[i], component, backTransform[i], transGroup);
+		shared_ptr<const DataStore> compStore = DataStore::Snapshot(std::move(component));
 		if (!solver->Formulate(compStore) || !solver->Solve())
 		{
 			fprintf(stderr, "        [-] Unable to solve or formulate.\n");
@@ -129,7 +139,7 @@ bool DPSolver::processComponents()
 			X[id] = solver->X[j];
 			if (solver->U[j])
 			{
-				int contigLen = compStore[j].Sequence.Nucleotides.length();
+				int contigLen = (*compStore)[j].Length();
 				minX[i] = min(minX[i], (solver->T[j] == 1 ? solver->X[j] - contigLen + 1 : solver->X[j]));
 				maxX[i] = max(maxX[i], (solver->T[j] == 0 ? solver->X[j] + contigLen - 1 : solver->X[j]));
 			}
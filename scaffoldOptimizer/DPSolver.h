@@ -46,6 +46,7 @@ public:
 
 public:
 	virtual bool Formulate(const DataStore &store);
+	bool Formulate(const shared_ptr<const DataStore> &store);
 	virtual bool Solve();
 	virtual SolverStatus GetStatus() const;
 	virtual double GetObjective() const;
@@ -63,7 +64,7 @@ public:
 	int MaxIteration;
 
 private:
-	DataStore store;
+	shared_ptr<const DataStore> store;
 	DPGraph graph;
 	vector< vector<int> > connectedComponents;
 	int nComponents;
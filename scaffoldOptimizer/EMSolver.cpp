@@ -46,7 +46,14 @@ bool EMSolver::Formulate(const DataStore &store)
 {
 	if (status != Clean)
 		return false;
-	ContigCount = store.ContigCount;
+	return Formulate(DataStore::Snapshot(store));
+}
+
+bool EMSolver::Formulate(const shared_ptr<const DataStore> &store)
+{
+	if (status != Clean)
+		return false;
+	ContigCount = store->ContigCount;
 	U.resize(ContigCount, true);
 	T.resize(ContigCount);
 	X.resize(ContigCount);
@@ -145,13 +152,13 @@ int EMSolver::GetSlackCount() const
 
 const DataStore &EMSolver::GetStore() const
 {
-	return store;
+	return *store;
 }
 
 void EMSolver::prepareSlacks()
 {
 	int count = 0;
-	for (DataStore::LinkMap::const_iterator it = store.Begin(); it != store.End(); it++)
+	for (DataStore::LinkMap::const_iterator it = store->Begin(); it != store->End(); it++)
 		count++;
 	distanceSlack.assign(count, 0);
 	orderSlack.assign(count, 0);
@@ -176,7 +183,7 @@ bool EMSolver::expectation()
 	delete ga;
 	ga = new GASolver();
 	ga->Options = Options;
-	if (!ga->Formulate(store, distanceSlack, orderSlack))
+	if (!ga->Formulate(*store, distanceSlack, orderSlack))
 		return false;
 	if (iterative != NULL && iterative->GetStatus() == Success)
 		ga->AddIndividual(iterative->T);
@@ -200,7 +207,7 @@ bool EMSolver::maximization()
 void EMSolver::updateSlack()
 {
 	int num = 0, id = 0;
-	for (DataStore::LinkMap::const_iterator it = store.Begin(); it != store.End(); it++, id++)
+	for (DataStore::LinkMap::const_iterator it = store->Begin(); it != store->End(); it++, id++)
 	{
 		int a = it->first.first, b = it->first.second;
 		if ((ga->T[a] ^ ga->T[b]) != it->second.EqualOrientation)
@@ -42,6 +42,7 @@ public:
 
 public:
 	virtual bool Formulate(const DataStore &store);
+	bool Formulate(const shared_ptr<const DataStore> &store);
 	virtual bool Solve();
 	virtual SolverStatus GetStatus() const;
 	virtual double GetObjective() const;
@@ -73,7 +74,8 @@ private:
 	int timerId;
 	GASolver *ga;
 	IterativeSolver *iterative;
-	DataStore store;
+	// shared with the iterative solvers of every maximization step
+	shared_ptr<const DataStore> store;
 	vector<double> distanceSlack, orderSlack;
 	vector<bool> bestT;
 	vector<double> bestX;
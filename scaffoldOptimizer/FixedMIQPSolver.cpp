@@ -170,7 +170,7 @@ bool FixedMIQPSolver::addContig(const Contig &contig)
 	int id = contig.GetID();
 	try
 	{
-		len[id] = contig.Sequence.Nucleotides.length();
+		len[id] = contig.Length();
 		x.add(IloNumVar(environment, 0, CoordMax));
 	}
 	catch (...)
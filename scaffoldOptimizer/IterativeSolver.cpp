@@ -48,7 +48,21 @@ bool IterativeSolver::Formulate(const DataStore &store, const vector<double> &co
 {
 	if (status != Clean)
 		return false;
-	if (!solver.Formulate(store, vector<bool>(), vector<bool>(), coord))
+	return Formulate(DataStore::Snapshot(store), coord);
+}
+
+bool IterativeSolver::Formulate(const DataStore &store)
+{
+	if (status != Clean)
+		return false;
+	return Formulate(DataStore::Snapshot(store));
+}
+
+bool IterativeSolver::Formulate(const shared_ptr<const DataStore> &store, const vector<double> &coord)
+{
+	if (status != Clean)
+		return false;
+	if (!solver.Formulate(*store, vector<bool>(), vector<bool>(), coord))
 	{
 		status = Fail;
 		return false;
@@ -60,11 +74,11 @@ bool IterativeSolver::Formulate(const DataStore &store, const vector<double> &co
 	return true;
 }
 
-bool IterativeSolver::Formulate(const DataStore &store)
+bool IterativeSolver::Formulate(const shared_ptr<const DataStore> &store)
 {
 	if (status != Clean)
 		return false;
-	if (!solver.Formulate(store))
+	if (!solver.Formulate(*store))
 	{
 		status = Fail;
 		return false;
@@ -94,7 +108,7 @@ bool IterativeSolver::Solve()
 		if (solver.GetOrderSlack(i) > ExtendedFixedMIQPSolver::DesiredOrderSlackMax + Helpers::Eps)
 			order[i] = false, Disabled++;
 	}
-	if (((!coordinatesFormulation && !extension.Formulate(store, distance, order)) || (coordinatesFormulation && !extension.Formulate(store, distance, order, solver.X))) || !extension.Solve())
+	if (((!coordinatesFormulation && !extension.Formulate(*store, distance, order)) || (coordinatesFormulation && !extension.Formulate(*store, distance, order, solver.X))) || !extension.Solve())
 	{
 		status = Fail;
 		return false;
@@ -141,5 +155,5 @@ double IterativeSolver::GetHeuristicObjective() const
 
 const DataStore &IterativeSolver::GetStore() const
 {
-	return store;
+	return *store;
 }
@@ -42,6 +42,8 @@ public:
 public:
 	bool Formulate(const DataStore &store, const vector<double> &coord);
 	virtual bool Formulate(const DataStore &store);
+	bool Formulate(const shared_ptr<const DataStore> &store, const vector<double> &coord);
+	bool Formulate(const shared_ptr<const DataStore> &store);
 	virtual bool Solve();
 	virtual SolverStatus GetStatus() const;
 	virtual double GetObjective() const;
@@ -63,7 +65,7 @@ protected:
 private:
 	ExtendedFixedMIQPSolver solver;
 	ExtendedFixedMIQPSolver extension;
-	DataStore store;
+	shared_ptr<const DataStore> store;
 	bool coordinatesFormulation;
 };
 #endif
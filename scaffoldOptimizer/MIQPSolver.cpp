@@ -174,7 +174,7 @@ bool MIQPSolver::addContig(const Contig &contig)
 	int id = contig.GetID();
 	try
 	{
-		len[id] = contig.Sequence.Nucleotides.length();
+		len[id] = contig.Length();
 		optimized[id] = false;
 		x.add(IloNumVar(environment, 0, CoordMax));
 		u.add(IloBoolVar(environment));
@@ -54,7 +54,7 @@ vector<FastASequence> ScaffoldConverter::ToFasta(const DataStore &store, const S
     for (int i = 0; i < count; i++)
     {
         ScaffoldContig contig = scaffold[i];
-        FastASequence contigSeq = store[contig.Id].Sequence;
+        FastASequence contigSeq = store[contig.Id].GetFastA(contig.T);
         string sign;
         int contigLen = contigSeq.Nucleotides.length();
         int contigEnd = (!contig.T ? contig.X + contigLen : contig.X);
@@ -70,7 +70,6 @@ vector<FastASequence> ScaffoldConverter::ToFasta(const DataStore &store, const S
         }
         else
         {
-            contigSeq.ReverseCompelement();
             solutionDistance = contig.X - contigLen + 1 - solutionEnd;
             sign = "-";
         }
@@ -191,7 +190,7 @@ vector<FastASequence> ScaffoldConverter::ToFasta(const DataStore &store, const S
     for (int i = 0; i < count; i++)
     {
         ScaffoldContig contig = scaffold[i];
-        FastASequence contigSeq = store[contig.Id].Sequence;
+        FastASequence contigSeq = store[contig.Id].GetFastA(contig.T);
         int contigLen = contigSeq.Nucleotides.length();
         if (!contig.T)
         {
@@ -204,7 +203,6 @@ vector<FastASequence> ScaffoldConverter::ToFasta(const DataStore &store, const S
         else
         {
             //cout << i << " Reverse: " << contig.X << " - " << contigLen << " + 1 -" << end << " = " << contig.X - contigLen + 1 - end << endl;
-            contigSeq.ReverseCompelement();
             string spacer(max((int)contig.X - contigLen + 1 - solutionEnd, 0), 'N');
             sequence = sequence + spacer + contigSeq.Nucleotides;
             name = (!name.empty() ? name + "|-" : "-") + Helpers::ItoStr(contig.Id);
@@ -130,7 +130,7 @@ vector<Scaffold> ScaffoldExtractor::Extract(const IterativeSolver &solver)
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -148,7 +148,7 @@ vector<Scaffold> ScaffoldExtractor::Extract(const DataStore &store, const GASolv
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -171,7 +171,7 @@ vector<Scaffold> ScaffoldExtractor::Extract(const DataStore &store, const FixedM
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -194,7 +194,7 @@ vector<Scaffold> ScaffoldExtractor::Extract(const DataStore &store, const Branch
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -218,7 +218,7 @@ vector<Scaffold> ScaffoldExtractor::Extract(const EMSolver &solver)
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], solver.T[components[i][j]], solver.X[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -244,7 +244,7 @@ void ScaffoldExtractor::extractSingleScaffold(const DataStore &store, vector<Sca
 			bool isForward;
 			double position;
 			getOrientation(store[components[i][j]], isForward, position);
-			scaffold.AddContig(components[i][j], isForward, position, store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], isForward, position, store[components[i][j]].Length());
 		}
 		scaffold.Sort();
 		ans.push_back(scaffold);
@@ -270,7 +270,7 @@ void ScaffoldExtractor::extractOrientedScaffold(const DataStore &store, vector<S
 		int size = components[i].size();
 		Scaffold scaffold;
 		for (int j = 0; j < size; j++)
-			scaffold.AddContig(components[i][j], t[components[i][j]], x[components[i][j]], store[components[i][j]].Sequence.Nucleotides.length());
+			scaffold.AddContig(components[i][j], t[components[i][j]], x[components[i][j]], store[components[i][j]].Length());
 		scaffold.Sort();
 		ans.push_back(scaffold);
 	}
@@ -278,7 +278,7 @@ void ScaffoldExtractor::extractOrientedScaffold(const DataStore &store, vector<S
 
 bool ScaffoldExtractor::getOrientation(const Contig &contig, bool &orientation, double &position)
 {
-	string name = contig.Sequence.Name();
+	string name = contig.Name();
 	if (name[0] == '+')
 		orientation = false;
 	else if (name[0] == '-')
@@ -30,9 +30,11 @@
 #include <ctime>
 #include <cstdlib>
 #include <cstddef>
+#include <stdexcept>
 #include "Configuration.h"
 #include "DataStore.h"
 #include "DataStoreReader.h"
+#include "DataStoreWriter.h"
 #include "ReadCoverageReader.h"
 #include "ReadCoverageRepeatDetecter.h"
 #include "DPSolver.h"
@@ -342,7 +344,7 @@ void testBnB()
 {
 	vector<bool> tBest(store.ContigCount);
 	for (int i = 0; i < store.ContigCount; i++)
-		tBest[i] = getOrientation(store[i].Sequence.Name());
+		tBest[i] = getOrientation(store[i].Name());
 	BranchAndBound *bnb = new BranchAndBound(vector<bool>(store.ContigCount, true), tBest, store.ContigCount);
 	IterativeSolver *it = new IterativeSolver(vector<bool>(store.ContigCount, true), tBest, store.ContigCount);
 	it->Options = bnb->Options = config.Options;
@@ -422,7 +424,7 @@ void testGA(const GASolver &solver, const string &fileName)
 	vector<bool> tBest(store.ContigCount);
 	for (int i = 0; i < store.ContigCount; i++)
 	{
-		tBest[i] = getOrientation(store[i].Sequence.Name());
+		tBest[i] = getOrientation(store[i].Name());
 		if (tBest[i] != solver.T[i])
 			forwardMismatch++;
 		if (tBest[i] != !solver.T[i])
@@ -451,7 +453,7 @@ void testFormulation()
 {
 	vector<bool> uBest(store.ContigCount, 1), tBest(store.ContigCount);
 	for (int i = 0; i < store.ContigCount; i++)
-		tBest[i] = getOrientation(store[i].Sequence.Name());
+		tBest[i] = getOrientation(store[i].Name());
 	IterativeSolver solver(uBest, tBest, store.ContigCount);
 	solver.Options = config.Options;
 	if (!solver.Formulate(store))
@@ -472,14 +474,24 @@ void testFormulation()
 
 #endif
 
+// Contig sequences are only needed for the FastA output, so they stay in the
+// store file until then.
 bool readStore(const string &fileName, DataStore &store)
 {
 	DataStoreReader reader;
-	bool result = reader.Open(fileName) && reader.Read(store);
+	bool result = reader.Open(fileName) && reader.Read(store, true);
 	reader.Close();
 	return result;
 }
 
+bool writeStore(const string &fileName, const DataStore &store, bool binary)
+{
+	DataStoreWriter writer;
+	bool result = writer.Open(fileName) && writer.Write(store, binary);
+	writer.Close();
+	return result;
+}
+
 bool readCoverage(const string &fileName, ReadCoverage &coverage)
 {
     ReadCoverageReader reader;
@@ -509,10 +521,20 @@ bool outputScaffolds(const string &fileName, const vector<Scaffold> &scaffolds)
 	return true;
 }
 
-bool outputFastaScaffolds(const string &fileName, const vector<Scaffold> &scaffolds, const OverlapperConfiguration &config)
+bool outputFastaScaffolds(const string &fileName, const DataStore &store, const vector<Scaffold> &scaffolds, const OverlapperConfiguration &config)
 {
 	FastAWriter writer;
-	bool result = writer.Open(fileName) && writer.Write(ScaffoldConverter::ToFasta(store, scaffolds, config));
+	bool result;
+	try
+	{
+		result = writer.Open(fileName) && writer.Write(ScaffoldConverter::ToFasta(store, scaffolds, config));
+	}
+	catch (runtime_error &e)
+	{
+		// a contig read in lengths-only mode whose sequence file was moved or truncated
+		cerr << "[-] " << e.what() << endl;
+		result = false;
+	}
 	writer.Close();
 	return result;
 }
@@ -533,6 +555,9 @@ int main(int argc, char *argv[])
     if (config.ProcessCommandLine(argc, argv))
     {
         solver.Options = config.Options;
+        // -threads caps the link bundling and loading as well as the solvers
+        if (config.Options.Threads > 0)
+            DataStore::Threads = config.Options.Threads;
         if (!readStore(config.InputFileName, store))
         {
             cerr << "[-] Unable to read optimization problem (" << config.InputFileName << ")." << endl;
@@ -561,19 +586,52 @@ int main(int argc, char *argv[])
             cerr << "[i] Optimized matrix:" << endl;
             Helpers::PrintDataStore(store);
         }
+        // erosion and repeat isolation are applied in a single pass over the links
+        LinkFilter filter;
+        vector<int> repeats;
+        bool isolate = false;
         if (config.Erosion > 0)
-            cerr << "[i] Erosion removed " << store.Erode(config.Erosion) << " contig links." << endl;
+            filter.RemoveLighter(config.Erosion);
         if (!config.ReadCoverageFileName.empty())
         {
             if (!readCoverage(config.ReadCoverageFileName, coverage))
                 cerr << "[-] Unable to read contig coverage (" << config.ReadCoverageFileName << ")." << endl;
             else
             {
-                vector<int> repeats = ReadCoverageRepeatDetecter::Detect(config.ExpectedCoverage, coverage, store, config.UniquenessFCutoff);
-                cerr << "[i] Detected " << repeats.size() << " repeat contigs. Removed " << store.IsolateContigs(repeats) << " contig links to isolate them." << endl;
+                repeats = ReadCoverageRepeatDetecter::Detect(config.ExpectedCoverage, coverage, store, config.UniquenessFCutoff);
+                filter.Isolate(repeats);
+                isolate = true;
             }
         }
-        if (!solver.Formulate(store))
+        if (config.HubPercentile > 0)
+            filter.IsolateHubs(config.HubPercentile);
+        if (config.MaximumPartners > 0)
+            filter.CapPartners(config.MaximumPartners);
+        store.Filter(filter);
+        if (config.Erosion > 0)
+            cerr << "[i] Erosion removed " << filter.Removed(LinkFilter::LightLinks) << " contig links." << endl;
+        if (isolate)
+            cerr << "[i] Detected " << repeats.size() << " repeat contigs. Removed " << filter.Removed(LinkFilter::IsolatedContigs) << " contig links to isolate them." << endl;
+        if (config.HubPercentile > 0)
+        {
+            const vector<int> &hubs = filter.Hubs();
+            cerr << "[i] Detected " << hubs.size() << " hub contigs with more than " << filter.HubDegree() << " partners. Removed " << filter.Removed(LinkFilter::HubContigs) << " contig links to isolate them." << endl;
+            if (config.Options.VerboseOutput > 0)
+                for (vector<int>::const_iterator it = hubs.begin(); it != hubs.end(); it++)
+                    cerr << "    [i] Hub contig " << *it << " (" << store[*it].Name() << ")." << endl;
+        }
+        if (config.MaximumPartners > 0)
+            cerr << "[i] Partner cap removed " << filter.Removed(LinkFilter::CappedPartners) << " contig links between " << filter.CappedPairs() << " contig pairs." << endl;
+        if (!config.ProblemOutputFileName.empty())
+        {
+            if (!writeStore(config.ProblemOutputFileName, store, config.BinaryProblemOutput))
+                cerr << "[-] Unable to output the optimization problem (" << config.ProblemOutputFileName << ")." << endl;
+            else
+                cerr << "[+] Output the optimization problem (" << config.ProblemOutputFileName << ")." << endl;
+        }
+        // the solver shares the store from here on instead of copying it
+        shared_ptr<const DataStore> problem = DataStore::Snapshot(std::move(store));
+        if (!solver.Formulate(problem))
         {
             cerr << "[-] Unable to formulate the optimization problem." << endl;
             return -2;
@@ -586,7 +644,7 @@ int main(int argc, char *argv[])
         }
         cerr << "[+] Solved the optimization problem." << endl;
         fprintf(stderr, "[i] Objective function value: %.6lf\n", solver.GetObjective());
-        if (!outputFastaScaffolds(config.OutputFileName, ScaffoldExtractor::Extract(solver), config.OverlapperOptions))
+        if (!outputFastaScaffolds(config.OutputFileName, *problem, ScaffoldExtractor::Extract(solver), config.OverlapperOptions))
         {
             cerr << "[-] Unable to output scaffolds (FastA)." << endl;
             return -4;
@@ -0,0 +1,158 @@
+/*
+ * storeUtil : converts contig link stores between the text and the binary format.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include "Configuration.h"
+#include "Defines.h"
+#include "Helpers.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <strings.h>
+
+using namespace std;
+
+// Construtor with default configuration parameter settings.
+Configuration::Configuration()
+{
+	Success = false;
+	InputFileName = "";
+	OutputFileName = "";
+	BinaryOutput = true;
+	Threads = 0;
+}
+
+// Parses command line arguments. Returns true if successful.
+bool Configuration::ProcessCommandLine(int argc, char *argv[])
+{
+	this->Success = true;
+	stringstream serr;
+
+	if (argc < 2)
+	{
+		serr << "[-] Not enough arguments. Consult -help." << endl;
+		this->Success = false;
+	}
+	else
+	{
+		int i = 1;
+		while (i < argc)
+		{
+			if (!strcmp("-help", argv[i]) || !strcmp("-h", argv[i]))
+			{
+				printHelpMessage(serr);
+				this->Success = false;
+				break;
+			}
+			else if (!strcmp("-format", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -format: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				if (!strcasecmp(argv[i], "binary"))
+					BinaryOutput = true;
+				else if (!strcasecmp(argv[i], "text"))
+					BinaryOutput = false;
+				else
+				{
+					serr << "[-] Parsing error in -format: argument must be text/binary." << endl;
+					this->Success = false;
+					break;
+				}
+			}
+			else if (!strcmp("-merge", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -merge: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				MergeFileNames.push_back(argv[i]);
+			}
+			else if (!strcmp("-threads", argv[i]))
+			{
+				if (argc - i - 1 < 1)
+				{
+					serr << "[-] Parsing error in -threads: must have an argument." << endl;
+					this->Success = false;
+					break;
+				}
+				i++;
+				bool threadsSuccess;
+				Threads = Helpers::ParseInt(argv[i], threadsSuccess);
+				if (!threadsSuccess || Threads <= 0)
+				{
+					serr << "[-] Parsing error in -threads: number of threads must be a positive number." << endl;
+					this->Success = false;
+					break;
+				}
+			}
+			else if (i == argc - 2)
+				this->InputFileName = argv[argc - 2];
+			else if (i == argc - 1)
+				this->OutputFileName = argv[argc - 1];
+			else
+			{
+				serr << "[-] Unknown argument: " << argv[i] << endl;
+				this->Success = false;
+				break;
+			}
+			i++;
+		}
+		if (this->Success && this->InputFileName == "")
+		{
+			serr << "[-] No input file specified." << endl;
+			this->Success = false;
+		}
+		if (this->Success && this->OutputFileName == "")
+		{
+			serr << "[-] No output file specified." << endl;
+			this->Success = false;
+		}
+	}
+	if (!this->Success)
+		LastError = serr.str();
+	return this->Success;
+}
+
+void Configuration::printHelpMessage(stringstream &serr)
+{
+	serr << "[i] Store utility version " << VERSION << " (" << DATE << ")" << endl;
+	serr << "[i] By " << AUTHOR << endl;
+	serr << "[i] Usage: storeUtil [arguments] <input.opt> <output.opt>" << endl;
+	serr << "[i] Converts a store between the text and the binary format, merging other stores into it on the way. The input format is detected automatically." << endl;
+	serr << "[i] -help                                               Print this message and exit." << endl;
+	serr << "[i] -format <text/binary>                               Format of the output store. [binary]" << endl;
+	serr << "[i] -threads <n>                                         Number of threads used to load text stores. [all cores]" << endl;
+	serr << "[i] -merge <store.opt>                                  Add the groups and links of a store over the same contigs, e.g. from a linker run on another library; its read pair ids are offset past those already present. Can be repeated. [none]" << endl;
+}
@@ -0,0 +1,105 @@
+/*
+ * storeUtil : converts contig link stores between the text and the binary format.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+#include <iostream>
+#include "Configuration.h"
+#include "DataStore.h"
+#include "DataStoreReader.h"
+#include "DataStoreWriter.h"
+
+using namespace std;
+
+Configuration config;
+DataStore store;
+
+// Sequences are copied from the input file one at a time while writing.
+bool readStore(const string &fileName, DataStore &store)
+{
+	DataStoreReader reader;
+	bool result = reader.Open(fileName) && reader.Read(store, true);
+	reader.Close();
+	return result;
+}
+
+bool writeStore(const string &fileName, const DataStore &store, bool binary)
+{
+	DataStoreWriter writer;
+	bool result = writer.Open(fileName) && writer.Write(store, binary);
+	writer.Close();
+	return result;
+}
+
+void banner()
+{
+    cerr << "This program comes with ABSOLUTELY NO WARRANTY; see LICENSE for details." << endl;
+    cerr << "This is free software, and you are welcome to redistribute it" << endl;
+    cerr << "under certain conditions; see LICENSE for details." << endl;
+    cerr << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	banner();
+	if (config.ProcessCommandLine(argc, argv))
+	{
+		if (config.Threads > 0)
+			DataStore::Threads = config.Threads;
+		if (!readStore(config.InputFileName, store))
+		{
+			cerr << "[-] Unable to read store (" << config.InputFileName << ")." << endl;
+			return -2;
+		}
+		cerr << "[+] Read store (" << config.InputFileName << "): " << store.ContigCount << " contigs, " << store.GroupCount << " groups, " << store.LinkCount << " links." << endl;
+		for (vector<string>::const_iterator it = config.MergeFileNames.begin(); it != config.MergeFileNames.end(); it++)
+		{
+			DataStore other;
+			if (!readStore(*it, other))
+			{
+				cerr << "[-] Unable to read store (" << *it << ")." << endl;
+				return -4;
+			}
+			int64_t readPairOffset = store.ReadPairEnd();
+			if (!store.Merge(other))
+			{
+				cerr << "[-] Contigs of store (" << *it << ") do not match those of store (" << config.InputFileName << ")." << endl;
+				return -5;
+			}
+			cerr << "[+] Merged store (" << *it << "): " << other.GroupCount << " groups, " << other.LinkCount << " links." << endl;
+			if (other.ReadPairEnd() > 0)
+				cerr << "[i] Read pair ids of store (" << *it << ") offset by " << readPairOffset << "." << endl;
+		}
+		if (!writeStore(config.OutputFileName, store, config.BinaryOutput))
+		{
+			cerr << "[-] Unable to write store (" << config.OutputFileName << ")." << endl;
+			return -3;
+		}
+		cerr << "[+] Wrote " << (config.BinaryOutput ? "binary" : "text") << " store (" << config.OutputFileName << ")." << endl;
+		return 0;
+	}
+	cerr << config.LastError;
+	return -1;
+}
@@ -0,0 +1,183 @@
+/*
+ * Common : a collection of classes (re)used throughout the scaffolder implementation.
+ * Copyright (C) 2011  Alexey Gritsenko
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ * 
+ * 
+ * 
+ * Email: a.gritsenko@tudelft.nl
+ * Mail: Delft University of Technology
+ *       Faculty of Electrical Engineering, Mathematics, and Computer Science
+ *       Department of Mediamatics
+ *       P.O. Box 5031
+ *       2600 GA, Delft, The Netherlands
+ */
+
+// Checks that a store built through DataStoreBuilder from several threads equals the
+// store built by adding the same groups and links one after another, both when the
+// builder merges into a DataStore and when it feeds a LinkSink.
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "DataStore.h"
+#include "DataStoreBuilder.h"
+#include "Helpers.h"
+#include "LinkSink.h"
+
+using namespace std;
+
+static const int ContigCount = 2000;
+static const int ShardCount = 4;
+static const int GroupsPerShard = 3;
+static const int LinksPerShard = 50000;
+
+class Input
+{
+public:
+	vector<LinkGroup> Groups;
+	vector<int> LinkGroups;
+	vector<ContigLink> Links;
+};
+
+vector<Input> makeInputs()
+{
+	srand(1);
+	vector<Input> inputs(ShardCount);
+	for (int s = 0; s < ShardCount; s++)
+	{
+		for (int g = 0; g < GroupsPerShard; g++)
+			inputs[s].Groups.push_back(LinkGroup("group", "shard group"));
+		for (int i = 0; i < LinksPerShard; i++)
+		{
+			// few contigs per shard pair up often, so ties between shards are common
+			int first = rand() % ContigCount, second = rand() % 50;
+			ContigLink link(first, second, rand() % 1000, 1 + rand() % 20, rand() % 2, rand() % 2, 1 + rand() % 3, (rand() % 4 == 0 ? "c" + Helpers::ItoStr(i) : string()), LinkProvenance(i));
+			inputs[s].LinkGroups.push_back(rand() % GroupsPerShard);
+			inputs[s].Links.push_back(link);
+		}
+	}
+	return inputs;
+}
+
+void fillShard(const Input *input, DataStoreBuilder::Shard *shard)
+{
+	vector<int> ids;
+	for (size_t g = 0; g < input->Groups.size(); g++)
+		ids.push_back(shard->AddGroup(input->Groups[g]));
+	for (size_t i = 0; i < input->Links.size(); i++)
+		shard->AddLink(ids[input->LinkGroups[i]], input->Links[i]);
+}
+
+void buildShards(const vector<Input> &inputs, DataStoreBuilder &builder)
+{
+	vector<thread> workers;
+	for (int s = 0; s < ShardCount; s++)
+		workers.push_back(thread(fillShard, &inputs[s], &builder[s]));
+	for (int s = 0; s < ShardCount; s++)
+		workers[s].join();
+}
+
+void addContigs(DataStore &store)
+{
+	for (int i = 0; i < ContigCount; i++)
+		store.AddContig(Contig(FastASequence("ACGT", "contig" + Helpers::ItoStr(i))));
+}
+
+bool equal(const ContigLinkView &a, const ContigLinkView &b)
+{
+	ContigLink x(a), y(b);
+	return x.First == y.First && x.Second == y.Second && x.Mean == y.Mean && x.Std == y.Std && x.EqualOrientation == y.EqualOrientation
+		&& x.ForwardOrder == y.ForwardOrder && x.Weight == y.Weight && x.Comment == y.Comment && x.Provenance.First == y.Provenance.First
+		&& a.GetGroupID() == b.GetGroupID();
+}
+
+bool checkStore(const vector<Input> &inputs)
+{
+	DataStore serial, sharded;
+	addContigs(serial);
+	addContigs(sharded);
+	for (int s = 0; s < ShardCount; s++)
+	{
+		int base = serial.GroupCount;
+		for (size_t g = 0; g < inputs[s].Groups.size(); g++)
+			serial.AddGroup(inputs[s].Groups[g]);
+		for (size_t i = 0; i < inputs[s].Links.size(); i++)
+			serial.AddLink(base + inputs[s].LinkGroups[i], inputs[s].Links[i]);
+	}
+	DataStoreBuilder builder(ShardCount);
+	buildShards(inputs, builder);
+	builder.Merge(sharded);
+
+	if (serial.GroupCount != sharded.GroupCount || serial.LinkCount != sharded.LinkCount)
+		return false;
+	for (DataStore::LinkMap::const_iterator a = serial.Begin(), b = sharded.Begin(); a != serial.End(); a++, b++)
+		if (a->first != b->first || !equal(a->second, b->second))
+			return false;
+	return true;
+}
+
+bool checkSink(const vector<Input> &inputs)
+{
+	DataStore serial, sharded;
+	addContigs(serial);
+	addContigs(sharded);
+	// a small memory limit, so that both sinks spill runs
+	LinkSink serialLinks(1 << 20), shardedLinks(1 << 20);
+	for (int s = 0; s < ShardCount; s++)
+	{
+		int base = serial.GroupCount;
+		for (size_t g = 0; g < inputs[s].Groups.size(); g++)
+			serial.AddGroup(inputs[s].Groups[g]);
+		for (size_t i = 0; i < inputs[s].Links.size(); i++)
+			serialLinks.Add(base + inputs[s].LinkGroups[i], inputs[s].Links[i]);
+	}
+	DataStoreBuilder builder(ShardCount);
+	buildShards(inputs, builder);
+	if (!builder.Merge(sharded, shardedLinks))
+		return false;
+
+	if (serial.GroupCount != sharded.GroupCount || serialLinks.Size() != shardedLinks.Size())
+		return false;
+	if (!serialLinks.Rewind() || !shardedLinks.Rewind())
+		return false;
+	ContigLinkView a, b;
+	while (serialLinks.Next(a))
+		if (!shardedLinks.Next(b) || !equal(a, b))
+			return false;
+	return !shardedLinks.Next(b);
+}
+
+int main()
+{
+	vector<Input> inputs = makeInputs();
+	bool result = true;
+	if (checkStore(inputs))
+		cerr << "[+] Sharded store equals the serial store." << endl;
+	else
+	{
+		cerr << "[-] Sharded store differs from the serial store." << endl;
+		result = false;
+	}
+	if (checkSink(inputs))
+		cerr << "[+] Sharded link sink equals the serial link sink." << endl;
+	else
+	{
+		cerr << "[-] Sharded link sink differs from the serial link sink." << endl;
+		result = false;
+	}
+	return (result ? 0 : 1);
+}